@@ -32,6 +32,7 @@ void AB1805::setup(bool callBegin) {
 
     
     if (detectChip()) {
+        loadShadowRegisters();
         updateWakeReason();
         _log.infoln("AB1805 Detected");
 
@@ -345,12 +346,17 @@ bool AB1805::setWDT(int seconds) {
 }
 
 bool AB1805::setRtcFromTime(time_t time, uint8_t hundredths) {
-    struct tm *tm = gmtime(&time);
-    return setRtcFromTm(tm, hundredths);
+    uint8_t array[8];
+
+    _log.infoln("setRtcFromTime %lu.%d", (unsigned long)time, hundredths);
+
+    array[0] = valueToBcd(hundredths); // hundredths
+    unixToRegisters(time, &array[1], true);
+
+    return setRtcFromRegisters(array);
 }
 
 bool AB1805::setRtcFromTm(const struct tm *timeptr, uint8_t hundredths) {
-    static const char *errorMsg = "failure in setRtcFromTm %d";
     uint8_t array[8];
 
     _log.infoln("setRtcAsTm %s.%d", tmToString(timeptr).c_str(),hundredths);
@@ -358,10 +364,16 @@ bool AB1805::setRtcFromTm(const struct tm *timeptr, uint8_t hundredths) {
     array[0] = valueToBcd(hundredths); // hundredths
     tmToRegisters(timeptr, &array[1], true);
 
+    return setRtcFromRegisters(array);
+}
+
+bool AB1805::setRtcFromRegisters(const uint8_t *array) {
+    static const char *errorMsg = "failure in setRtcFromRegisters %d";
+
     // Can only write RTC registers when WRTC is 1
     bool bResult = setRegisterBit(REG_CTRL_1, REG_CTRL_1_WRTC);
     if (bResult) {
-        bResult = writeRegisters(REG_HUNDREDTH, array, sizeof(array));
+        bResult = writeRegisters(REG_HUNDREDTH, array, 8);
         if (bResult) {
             // Clear the REG_CTRL_1_WRTC after setting the RTC.
             // Aside from being a good thing to do, that's how we know we've set it.
@@ -380,12 +392,9 @@ bool AB1805::setRtcFromTm(const struct tm *timeptr, uint8_t hundredths) {
 }
 
 bool AB1805::getRtcAsTime(time_t &time, uint8_t &hundrths) {
-    struct tm tmstruct1;
-    struct tm tmstruct2;
-    struct tm tmstruct3;
-    uint8_t _hundrths1;
-    uint8_t _hundrths2;
-    uint8_t _hundrths3;
+    uint8_t array1[8];
+    uint8_t array2[8];
+    uint8_t array3[8];
 
     // Hundredths Synchronization per: https://abracon.com/Support/AppsManuals/Precisiontiming/AB18XX-Application-Manual.pdf section 5.6:
     /*
@@ -400,55 +409,51 @@ bool AB1805::getRtcAsTime(time_t &time, uint8_t &hundrths) {
     C. If the Hundredths Counter has rolled over to 00, and the Seconds Counter value from the second read is equal to the Seconds Counter value from the first read, perform the read again. The
     resulting value from this third read is guaranteed to be correct.
     */
+    // The registers are converted straight to Unix time with integer civil-date arithmetic - no struct tm / mktime
 
     // First perform a burst read:
-    bool bResult = getRtcAsTm(&tmstruct1, _hundrths1);
+    bool bResult = getRtcRegisters(array1);
+    const uint8_t *result = array1;
 
     //2. If the Hundredths Counter was 00, perform the read again. The resulting value from this second read is guaranteed to be correct.
-    if (_hundrths1 == 0){
-        bResult = getRtcAsTm(&tmstruct2, _hundrths2);
-        time = mktime(&tmstruct2);
-        hundrths = _hundrths2;
-        // _log.infoln("_hundrths2 %u", _hundrths2);
-        return bResult;
+    if (bResult && array1[0] == 0x00) {
+        bResult = getRtcRegisters(array2);
+        result = array2;
     }
 
     //3. If the Hundredths Counter was 99, perform the read again.
     //     A. If the Hundredths Counter is still 99, the results of the first read are guaranteed to be correct.
-    //     Note that it is possible that the second read is not correct.
-    //     B. If the Hundredths Counter has rolled over to 00, and the Seconds Counter value from the second read is equal to the Seconds Counter value from the first read plus 1, both reads produced
-    //     correct values. Alternatively, perform the read again. The resulting value from this third read is
-    //     guaranteed to be correct.
-    //     C. If the Hundredths Counter has rolled over to 00, and the Seconds Counter value from the second read is equal to the Seconds Counter value from the first read, perform the read again. The
-    //     resulting value from this third read is guaranteed to be correct.
-    else if(_hundrths1 == 99){
-        bResult = getRtcAsTm(&tmstruct2, _hundrths2);
-        if(_hundrths2 == 99){
-            time = mktime(&tmstruct1);
-            hundrths = _hundrths1;
-            //  _log.infoln("_hundrths1 %u", _hundrths1);
-            return bResult;
-        }
-        else{
-            bResult = getRtcAsTm(&tmstruct3, _hundrths3);
-            time = mktime(&tmstruct3);
-            hundrths = _hundrths3;
-            //  _log.infoln("_hundrths3 %u", _hundrths3);
-            return bResult;
+    //     B./C. Otherwise, the third read is guaranteed to be correct.
+    else if (bResult && array1[0] == 0x99) {
+        bResult = getRtcRegisters(array2);
+        if (bResult && array2[0] != 0x99) {
+            bResult = getRtcRegisters(array3);
+            result = array3;
         }
-    } 
+    }
 
     // 1. Read the Counters, using a burst read. If the Hundredths Counter is neither 00 nor 99, the read is correct.
-    else{
-        time = mktime(&tmstruct1);
-        hundrths = _hundrths1;
-        // _log.infoln("_hundrths1__ %u", _hundrths1);
-        return bResult;
+    if (bResult) {
+        time = registersToUnix(&result[1]);
+        hundrths = bcdToValue(result[0]);
     }
-    
+    else {
+        time = 0;
+        hundrths = 0;
+    }
+
     return bResult;   
 }
 
+bool AB1805::getRtcRegisters(uint8_t *array) {
+    // If we've set the time in the RTC, then the WTC bit will be 0.
+    // On power-up from cold, it's 1
+    if (isBitClear(REG_CTRL_1, REG_CTRL_1_WRTC)) {
+        return readRegisters(REG_HUNDREDTH, array, 8);
+    }
+    return false;
+}
+
 bool AB1805::getRtcAsTm(struct tm *timeptr, uint8_t &hundrths) {
     uint8_t array[8];
     bool bResult = false;
@@ -496,8 +501,12 @@ bool AB1805::testEN() {
 #endif
 
 bool AB1805::interruptAtTime(time_t time, uint8_t hundredths) {
-    struct tm *tm = gmtime(&time);
-    return interruptAtTm(tm, hundredths);
+    uint8_t array[7];
+
+    array[0] = valueToBcd(hundredths); // hundredths
+    unixToRegisters(time, &array[1], false);
+
+    return repeatingInterrupt(array, REG_TIMER_CTRL_RPT_MIN);
 }
 
 bool AB1805::interruptAtTm(struct tm *timeptr, uint8_t hundredths) {
@@ -505,6 +514,16 @@ bool AB1805::interruptAtTm(struct tm *timeptr, uint8_t hundredths) {
 }
 
 bool AB1805::repeatingInterrupt(struct tm *timeptr, uint8_t rptValue, uint8_t hundredths) {
+    uint8_t array[7];
+
+    tmToRegisters(timeptr, &array[1], false);
+    
+    array[0] = valueToBcd(hundredths); // hundredths
+
+    return repeatingInterrupt(array, rptValue);
+}
+
+bool AB1805::repeatingInterrupt(const uint8_t *array, uint8_t rptValue) {
     static const char *errorMsg = "failure in repeatingInterrupt %d";
     bool bResult;
 
@@ -523,14 +542,9 @@ bool AB1805::repeatingInterrupt(struct tm *timeptr, uint8_t rptValue, uint8_t hu
     }
 
     // Set alarm registers
-    uint8_t array[7];
-
-    tmToRegisters(timeptr, &array[1], false);
-    
-    array[0] = valueToBcd(hundredths); // hundredths
     _log.infoln("hundredths reg set to: %u", bcdToValue(array[0]));
 
-    bResult = writeRegisters(REG_HUNDREDTH_ALARM, array, sizeof(array));
+    bResult = writeRegisters(REG_HUNDREDTH_ALARM, array, 7);
     if (!bResult) {
         _log.errorln(errorMsg, __LINE__);
         return false;
@@ -548,8 +562,8 @@ bool AB1805::repeatingInterrupt(struct tm *timeptr, uint8_t rptValue, uint8_t hu
 #endif
 
     // Set FOUT/nIRQ control in OUT1S in Control2 for 
-    // "nAIRQ if AIE is set, else OUT"
-    bResult = maskRegister(REG_CTRL_2, ~REG_CTRL_2_OUT1S_MASK, REG_CTRL_2_OUT1S_nAIRQ);
+    // "nAIRQ if AIE is set, else OUT" - or any interrupt if the repeating countdown timer is also in use
+    bResult = maskRegister(REG_CTRL_2, ~REG_CTRL_2_OUT1S_MASK, isBitSet(REG_INT_MASK, REG_INT_MASK_TIE) ? REG_CTRL_2_OUT1S_nIRQ : REG_CTRL_2_OUT1S_nAIRQ);
     if (!bResult) {
         _log.errorln(errorMsg, __LINE__);
         return false;
@@ -629,6 +643,93 @@ bool AB1805::interruptCountdownTimer(int value, bool minutes) {
     return true;
 }
 
+bool AB1805::setRepeatingCountdownTimer(uint32_t periodMs, uint32_t &actualMs) {
+    static const char *errorMsg = "failure in setRepeatingCountdownTimer %d";
+    bool bResult;
+
+    actualMs = 0;
+
+    // Stop the countdown timer (it can't be set while running) but leave the alarm repeat setting alone
+    bResult = maskRegister(REG_TIMER_CTRL, REG_TIMER_CTRL_RPT_MASK, REG_TIMER_CTRL_TFS_1_60);
+    if (!bResult) {
+        _log.errorln(errorMsg, __LINE__);
+        return false;
+    }
+
+    if (periodMs == 0) {
+        bResult = clearRegisterBit(REG_INT_MASK, REG_INT_MASK_TIE);
+        if (!bResult) {
+            _log.errorln(errorMsg, __LINE__);
+            return false;
+        }
+        return true;
+    }
+
+    // Pick the fastest timer clock that can count the whole period in 8 bits
+    uint8_t tfs;
+    uint32_t ticks;
+    uint32_t tickUs;
+    if (periodMs <= (255UL * 1000UL) / 64) {
+        tfs = REG_TIMER_CTRL_TFS_64;
+        tickUs = 15625;                             // 1/64 second
+    }
+    else if (periodMs <= 255UL * 1000UL) {
+        tfs = REG_TIMER_CTRL_TFS_1;
+        tickUs = 1000000;
+    }
+    else {
+        tfs = REG_TIMER_CTRL_TFS_1_60;
+        tickUs = 60000000;
+    }
+    ticks = (uint32_t)(((uint64_t)periodMs * 1000 + tickUs / 2) / tickUs);
+    if (ticks < 1) {
+        ticks = 1;
+    }
+    if (ticks > 255) {
+        ticks = 255;
+    }
+    actualMs = (uint32_t)(((uint64_t)ticks * tickUs) / 1000);
+
+    uint8_t array[2] = { (uint8_t)ticks, (uint8_t)ticks };     // REG_TIMER and REG_TIMER_INITIAL (reload) are adjacent
+    bResult = writeRegisters(REG_TIMER, array, sizeof(array));
+    if (!bResult) {
+        _log.errorln(errorMsg, __LINE__);
+        return false;
+    }
+
+    // Clear any pending countdown interrupt
+    bResult = clearRegisterBit(REG_STATUS, REG_STATUS_TIM);
+    if (!bResult) {
+        _log.errorln(errorMsg, __LINE__);
+        return false;
+    }
+
+    // Enable countdown timer interrupt (TIE = 1) in IntMask
+    bResult = setRegisterBit(REG_INT_MASK, REG_INT_MASK_TIE);
+    if (!bResult) {
+        _log.errorln(errorMsg, __LINE__);
+        return false;
+    }
+
+    // Set FOUT/nIRQ control in OUT1S in Control2 for 
+    // "nIRQ if at least one interrupt is enabled, else OUT" so the alarm can still wake us too
+    bResult = maskRegister(REG_CTRL_2, ~REG_CTRL_2_OUT1S_MASK, REG_CTRL_2_OUT1S_nIRQ);
+    if (!bResult) {
+        _log.errorln(errorMsg, __LINE__);
+        return false;
+    }
+
+    // Start the timer - pulse interrupts (TM), reload on zero (TRPT)
+    bResult = maskRegister(REG_TIMER_CTRL, REG_TIMER_CTRL_RPT_MASK, REG_TIMER_CTRL_TE | REG_TIMER_CTRL_TM | REG_TIMER_CTRL_TRPT | tfs);
+    if (!bResult) {
+        _log.errorln(errorMsg, __LINE__);
+        return false;
+    }
+
+    _log.infoln("repeating countdown timer %lu ticks, period %lu ms", ticks, actualMs);
+    return true;
+}
+
 bool AB1805::deepPowerDown(int seconds) {
     static const char *errorMsg = "failure in deepPowerDown %d";
     bool bResult;
@@ -848,9 +949,58 @@ bool AB1805::readRegister(uint8_t regAddr, uint8_t &value) {
     return readRegisters(regAddr, &value, 1);
 }
 
+// [static]
+int AB1805::shadowIndex(uint8_t regAddr) {
+    switch(regAddr) {
+        case REG_CTRL_1:        return 0;
+        case REG_CTRL_2:        return 1;
+        case REG_INT_MASK:      return 2;
+        case REG_SQW:           return 3;
+        case REG_TIMER_CTRL:    return 4;
+        case REG_OSC_CTRL:      return 5;
+        case REG_OCTRL:         return 6;
+        default:                return -1;
+    }
+}
+
+bool AB1805::loadShadowRegisters() {
+    static const char *errorMsg = "failure in loadShadowRegisters %d";
+    bool bResult;
+
+    shadowValid = false;
+
+    // REG_CTRL_1 to REG_SQW are contiguous and refresh the shadow as a block
+    uint8_t array[4];
+    bResult = readRegisters(REG_CTRL_1, array, sizeof(array));
+    if (bResult) {
+        bResult = readRegister(REG_TIMER_CTRL, shadowRegs[shadowIndex(REG_TIMER_CTRL)]);
+    }
+    if (bResult) {
+        bResult = readRegister(REG_OSC_CTRL, shadowRegs[shadowIndex(REG_OSC_CTRL)]);
+    }
+    if (bResult) {
+        bResult = readRegister(REG_OCTRL, shadowRegs[shadowIndex(REG_OCTRL)]);
+    }
+    if (!bResult) {
+        _log.errorln(errorMsg, __LINE__);
+        return false;
+    }
+
+    shadowValid = true;
+    return true;
+}
+
 bool AB1805::readRegisters(uint8_t regAddr, uint8_t *array, size_t num) {
     bool bResult = false;
 
+    if (num == 1 && shadowValid) {
+        int index = shadowIndex(regAddr);
+        if (index >= 0) {
+            array[0] = shadowRegs[index];
+            return true;
+        }
+    }
+
     Wire.beginTransmission(i2cAddr);
     Wire.write(regAddr);
     int stat = Wire.endTransmission(false);
@@ -859,6 +1009,11 @@ bool AB1805::readRegisters(uint8_t regAddr, uint8_t *array, size_t num) {
         if (count == num) {
             for(size_t ii = 0; ii < num; ii++) {
                 array[ii] = Wire.read();
+
+                int index = shadowIndex(regAddr + ii);
+                if (index >= 0) {
+                    shadowRegs[index] = array[ii];
+                }
             }
 
             bResult = true;
@@ -899,6 +1054,12 @@ bool AB1805::writeRegisters(uint8_t regAddr, const uint8_t *array, size_t num) {
     }
     int stat = Wire.endTransmission(true);
     if (stat == 0) {
+        for(size_t ii = 0; ii < num; ii++) {
+            int index = shadowIndex(regAddr + ii);
+            if (index >= 0) {
+                shadowRegs[index] = array[ii];
+            }
+        }
         bResult = true;
     }
     else {
@@ -1097,15 +1258,32 @@ void AB1805::registersToTm(const uint8_t *array, struct tm *timeptr, bool includ
     timeptr->tm_wday = bcdToValue(*p++);
 }
 
+// [static]
+int32_t AB1805::daysFromCivil(int year, unsigned month, unsigned day) {
+    return AB1805Time::daysFromCivil(year, month, day);
+}
+
+// [static]
+void AB1805::civilFromDays(int32_t days, int &year, unsigned &month, unsigned &day) {
+    AB1805Time::civilFromDays(days, year, month, day);
+}
+
+// [static]
+time_t AB1805::registersToUnix(const uint8_t *array) {
+    return AB1805Time::registersToUnix(array);
+}
+
+// [static]
+void AB1805::unixToRegisters(time_t time, uint8_t *array, bool includeYear) {
+    AB1805Time::unixToRegisters(time, array, includeYear);
+}
+
 // [static] 
 int AB1805::bcdToValue(uint8_t bcd) {
-    return (bcd >> 4) * 10 + (bcd & 0x0f);
+    return AB1805Time::bcdToValue(bcd);
 }
 
 // [static] 
 uint8_t AB1805::valueToBcd(int value) {
-    int tens = (value / 10) % 10;
-    int ones = value % 10;
-
-    return (uint8_t) ((tens << 4) | ones);
-}
\ No newline at end of file
+    return AB1805Time::valueToBcd(value);
+}
@@ -5,6 +5,7 @@
 #include <Wire.h>
 #include <Arduino.h>
 #include <ArduinoLog.h>
+#include "AB1805_Time.h"
 
 static Logging _log;
 
@@ -312,6 +313,17 @@ public:
      */
     bool repeatingInterrupt(struct tm *timeptr, uint8_t rptValue, uint8_t hundredths = 0);
 
+    /**
+     * @brief Set a repeating interrupt from alarm register values
+     * 
+     * @param array 7 bytes in register order starting at the hundredths alarm (REG_HUNDREDTH_ALARM - REG_WEEKDAY_ALARM)
+     * 
+     * @param rptValue a constant for which fields are matched, as for the struct tm version
+     * 
+     * @return true on success or false if an error occurs.
+     */
+    bool repeatingInterrupt(const uint8_t *array, uint8_t rptValue);
+
     /**
      * @brief Clear repeating interrupt set with `repeatingInterrupt()`.
 
@@ -333,6 +345,24 @@ public:
      */
     bool interruptCountdownTimer(int value, bool minutes);
 
+    /**
+     * @brief Interrupt on FOUT/nIRQ periodically using the repeating countdown timer
+     * 
+     * @param periodMs Period in milliseconds. 0 stops the periodic interrupt. Periods up to ~4 seconds
+     * use the 64 Hz timer clock (1/64 second resolution), up to 255 seconds the 1 Hz clock and up to
+     * 255 minutes the 1/60 Hz clock. Longer periods are clamped.
+     * 
+     * @param actualMs Filled in with the period that was actually programmed after rounding
+     * 
+     * @return true on success or false if an error occurs.
+     * 
+     * The timer reloads itself from REG_TIMER_INITIAL, so it does not need to be reprogrammed each cycle.
+     * It uses pulse mode (TM = 1) and shares FOUT/nIRQ with the alarm. FOUT/nIRQ is switched to nIRQ
+     * (any enabled interrupt) so that either one can wake the MCU. The alarm repeat bits in
+     * REG_TIMER_CTRL are preserved.
+     */
+    bool setRepeatingCountdownTimer(uint32_t periodMs, uint32_t &actualMs);
+
     /**
      * @brief Enters deep power down reset mode, using the EN pin
      * 
@@ -468,6 +498,24 @@ public:
      */
     bool setRtcFromTm(const struct tm *timeptr, uint8_t hundredths = 0);
 
+    /**
+     * @brief Set the RTC from register values
+     * 
+     * @param array 8 bytes in register order starting at the hundredths (REG_HUNDREDTH - REG_WEEKDAY)
+     * 
+     * @return true on success or false if an error occurs.
+     */
+    bool setRtcFromRegisters(const uint8_t *array);
+
+    /**
+     * @brief Burst read of the time registers
+     * 
+     * @param array Filled in with 8 bytes starting at REG_HUNDREDTH
+     * 
+     * @return false if the RTC has not been set or the read failed
+     */
+    bool getRtcRegisters(uint8_t *array);
+
     
     /**
      * @brief Reads a AB1805 register (single byte)
@@ -479,6 +527,9 @@ public:
      * @return true on success or false on error
      * 
      * There is also an overload that returns value instead of passing it by reference.
+     * 
+     * Control registers that are shadowed (see isShadowed()) are returned from RAM without an I2C transaction
+     * once setup() has loaded the shadow copy.
      */
     bool readRegister(uint8_t regAddr, uint8_t &value);
 
@@ -508,6 +559,9 @@ public:
      * it's atomic (counters will not be incremented in the middle of a read). Also used
      * for reading the device RAM.
      * 
+     * A single shadowed register is served from the shadow copy. Multi-register reads always go to
+     * the chip and refresh any shadowed registers they cover.
+     * 
      * Do not read past address 0xff. 
      */
     bool readRegisters(uint8_t regAddr, uint8_t *array, size_t num);
@@ -535,7 +589,7 @@ public:
      * 
      * @return true on success or false on error
      * 
-     * Do not write past address 0xff. 
+     * Do not write past address 0xff. Shadowed registers in the range are updated after a successful write.
      */
     bool writeRegisters(uint8_t regAddr, const uint8_t *array, size_t num);
 
@@ -552,7 +606,8 @@ public:
      * 
      * 
      * If the value is unchanged after the andValue and orValue is applied, the write is skipped.
-     * The read is always done.
+     * The read is always done, but for shadowed registers it comes from RAM so the operation is
+     * a single I2C write (or nothing at all).
      */
     bool maskRegister(uint8_t regAddr, uint8_t andValue, uint8_t orValue);
 
@@ -606,6 +661,25 @@ public:
      */
     bool setRegisterBit(uint8_t regAddr, uint8_t bitMask);
 
+    /**
+     * @brief Re-reads the shadowed control registers from the chip
+     * 
+     * @return true on success or false on error
+     * 
+     * Called from setup(). Only needed again if something other than this class changes the registers
+     * (a software reset, for example).
+     */
+    bool loadShadowRegisters();
+
+    /**
+     * @brief Returns true if a register is one of the control registers kept in the shadow copy
+     * 
+     * REG_CTRL_1, REG_CTRL_2, REG_INT_MASK, REG_SQW, REG_TIMER_CTRL, REG_OSC_CTRL and REG_OCTRL are
+     * only changed by the host, so they can be cached. Status registers (REG_STATUS, REG_OSC_STATUS, ...)
+     * are set by the chip and are always read live.
+     */
+    static bool isShadowed(uint8_t regAddr) { return shadowIndex(regAddr) >= 0; }
+
 	/**
 	 * @brief Returns the length of the RTC RAM in bytes (always 256)
 	 */
@@ -708,6 +782,40 @@ public:
      */
     static void registersToTm(const uint8_t *array, struct tm *timeptr, bool includeYear);
 
+    /**
+     * @brief Convert the AB1805 time registers directly to Unix time (UTC)
+     * 
+     * @param array Pointer to the seconds register value (not hundredths) followed by minutes, hours,
+     * date, month and year. The year is taken to be 2000 - 2099.
+     * 
+     * Integer only - does not use struct tm or mktime. See AB1805_Time.h.
+     */
+    static time_t registersToUnix(const uint8_t *array);
+
+    /**
+     * @brief Convert Unix time (UTC) directly to AB1805 register values
+     * 
+     * @param time Seconds since January 1, 1970 UTC. Must be in 2000 - 2099 for the year register.
+     * 
+     * @param array Same layout as tmToRegisters(): at least 6 bytes if includeYear is false or 7 if true,
+     * starting at the seconds field.
+     * 
+     * @param includeYear True if the year should be included (time setting) or false (alarm setting).
+     * 
+     * Integer only - does not use struct tm or gmtime. See AB1805_Time.h.
+     */
+    static void unixToRegisters(time_t time, uint8_t *array, bool includeYear);
+
+    /**
+     * @brief Days since 1970-01-01 for a proleptic Gregorian date (month 1-12, day 1-31)
+     */
+    static int32_t daysFromCivil(int year, unsigned month, unsigned day);
+
+    /**
+     * @brief Proleptic Gregorian date for a number of days since 1970-01-01 - inverse of daysFromCivil()
+     */
+    static void civilFromDays(int32_t days, int &year, unsigned &month, unsigned &day);
+
     /**
      * @brief Convert a bcd value (0x00-0x99) into an integer (0-99)
      */
@@ -970,6 +1078,26 @@ protected:
      */
     static AB1805 *instance;
 
+    /**
+     * @brief Maps a register address to its slot in shadowRegs or -1 if the register is not shadowed
+     */
+    static int shadowIndex(uint8_t regAddr);
+
+    /**
+     * @brief Number of registers in the shadow copy
+     */
+    static const size_t SHADOW_REGS = 7;
+
+    /**
+     * @brief Last known values of the shadowed control registers (indexed by shadowIndex())
+     */
+    uint8_t shadowRegs[SHADOW_REGS];
+
+    /**
+     * @brief True once loadShadowRegisters() has succeeded. Until then every read goes to the chip
+     */
+    bool shadowValid = false;
+
 };
 
 #endif /* __AB1805RK_H */
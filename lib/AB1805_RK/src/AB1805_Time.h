@@ -0,0 +1,105 @@
+#ifndef __AB1805_TIME_H
+#define __AB1805_TIME_H
+
+#include <stdint.h>
+#include <time.h> // time_t
+
+/**
+ * @brief Integer-only conversions between the AB1805 BCD time registers and Unix time (UTC)
+ *
+ * Kept free of Arduino and Wire so the conversions can be unit tested on the host
+ * (pio test -e native). The AB1805 class exposes the same functions as static members.
+ */
+namespace AB1805Time {
+
+    /**
+     * @brief Convert a bcd value (0x00-0x99) into an integer (0-99)
+     */
+    inline int bcdToValue(uint8_t bcd) {
+        return (bcd >> 4) * 10 + (bcd & 0x0f);
+    }
+
+    /**
+     * @brief Convert an integer value (0-99) into a bcd value (0x00 - 0x99)
+     */
+    inline uint8_t valueToBcd(int value) {
+        int tens = (value / 10) % 10;
+        int ones = value % 10;
+
+        return (uint8_t) ((tens << 4) | ones);
+    }
+
+    /**
+     * @brief Days since 1970-01-01 for a proleptic Gregorian date (month 1-12, day 1-31)
+     */
+    inline int32_t daysFromCivil(int year, unsigned month, unsigned day) {
+        // Howard Hinnant's days_from_civil - eras of 400 years, March-based years so the leap day is last
+        year -= (month <= 2);
+        const int32_t era = (year >= 0 ? year : year - 399) / 400;
+        const uint32_t yoe = (uint32_t)(year - era * 400);                                  // [0, 399]
+        const uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;      // [0, 365]
+        const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                         // [0, 146096]
+        return era * 146097 + (int32_t)doe - 719468;
+    }
+
+    /**
+     * @brief Proleptic Gregorian date for a number of days since 1970-01-01 - inverse of daysFromCivil()
+     */
+    inline void civilFromDays(int32_t days, int &year, unsigned &month, unsigned &day) {
+        days += 719468;
+        const int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const uint32_t doe = (uint32_t)(days - era * 146097);                               // [0, 146096]
+        const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;         // [0, 399]
+        const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);                       // [0, 365]
+        const uint32_t mp = (5 * doy + 2) / 153;                                            // [0, 11] from March
+        day = doy - (153 * mp + 2) / 5 + 1;
+        month = (mp < 10) ? mp + 3 : mp - 9;
+        year = (int)yoe + era * 400 + (month <= 2);
+    }
+
+    /**
+     * @brief Convert the AB1805 time registers (seconds first, not hundredths) to Unix time.
+     * The year register is taken to be 2000 - 2099.
+     */
+    inline time_t registersToUnix(const uint8_t *array) {
+        // Mask off the GP bits that share the seconds, minutes, hours, date and month registers
+        int sec = bcdToValue(array[0] & 0x7f);
+        int min = bcdToValue(array[1] & 0x7f);
+        int hour = bcdToValue(array[2] & 0x3f);
+        unsigned day = bcdToValue(array[3] & 0x3f);
+        unsigned month = bcdToValue(array[4] & 0x1f);
+        int year = 2000 + bcdToValue(array[5]);
+
+        return (time_t)daysFromCivil(year, month, day) * 86400 + hour * 3600 + min * 60 + sec;
+    }
+
+    /**
+     * @brief Convert Unix time to AB1805 register values: seconds, minutes, hours, date, month,
+     * [year,] weekday. Writes 7 bytes if includeYear is true or 6 if false.
+     */
+    inline void unixToRegisters(time_t time, uint8_t *array, bool includeYear) {
+        int32_t days = (int32_t)(time / 86400);
+        int32_t secs = (int32_t)(time - (time_t)days * 86400);
+        if (secs < 0) {
+            secs += 86400;
+            days--;
+        }
+
+        int year;
+        unsigned month, day;
+        civilFromDays(days, year, month, day);
+
+        uint8_t *p = array;
+        *p++ = valueToBcd(secs % 60);
+        *p++ = valueToBcd((secs / 60) % 60);
+        *p++ = valueToBcd(secs / 3600);
+        *p++ = valueToBcd(day);
+        *p++ = valueToBcd(month);
+        if (includeYear) {
+            *p++ = valueToBcd(year % 100);
+        }
+        *p++ = valueToBcd((days % 7 + 11) % 7);         // 1970-01-01 was a Thursday (4)
+    }
+}
+
+#endif /* __AB1805_TIME_H */
@@ -264,6 +264,34 @@ void MMA8452Q::clearTapInts() {
 	readRegister(PULSE_SRC);			// Reading this register clears the interrupt.
 }
 
+// MASK THE TAP INTERRUPT
+//	The pulse function keeps running and latching events in PULSE_SRC, but INT2 is no longer driven.
+//	CTRL_REG4 can only be changed in standby.
+void MMA8452Q::disableTapInts() {
+	standby();
+	writeRegister(CTRL_REG4, readRegister(CTRL_REG4) & ~0x08);	// Clear INT_EN_PULSE
+	active();
+}
+
+// SET THE TAP THRESHOLDS
+//	Overrides the thresholds set from the sensitivity in setupTapIntsLatch() / setupTapIntsPulse().
+//	Multiply the value by 0.0625g/LSB to get the threshold on each axis.
+void MMA8452Q::setTapThresholds(byte xThs, byte yThs, byte zThs)
+{
+	standby();  // Must be in standby to change registers
+	writeRegister(PULSE_THSX, xThs & 0x7F);
+	writeRegister(PULSE_THSY, yThs & 0x7F);
+	writeRegister(PULSE_THSZ, zThs & 0x7F);
+	active();
+}
+
+// UNMASK THE TAP INTERRUPT
+void MMA8452Q::enableTapInts() {
+	standby();
+	writeRegister(CTRL_REG4, readRegister(CTRL_REG4) | 0x08);	// Set INT_EN_PULSE
+	active();
+}
+
 
 // READ TAP STATUS
 //	This function returns any taps read by the MMA8452Q. If the function
@@ -124,6 +124,13 @@ public:
 	void setupTapIntsPulse(byte sensitivity=1);
 	void clearTapInts();
 
+	// Mask and unmask the tap interrupt without changing the pulse configuration - PULSE_SRC still latches while masked
+	void disableTapInts();
+	void enableTapInts();
+
+	// Set the per-axis pulse thresholds directly (0-127, 0.063g per LSB) - used for site-specific thresholds
+	void setTapThresholds(byte xThs, byte yThs, byte zThs);
+
 
 	void standby();
 	void active();
@@ -26,6 +26,19 @@
 /**  Timing Settings  **/
 #define TIME_HIGH_BEFORE_DETECTING 100UL        // Only initiate a detection if the sensor pin is high for TIME_HIGH_BEFORE_DETECTING ms
 #define TRANSMIT_LATENCY 5UL						        // How many seconds do we wait to send a message after the count has changed
+#define PERIODIC_WAKE_MS 60000UL                // The AB1805 countdown timer wakes us this often while sleeping
+#define PERSIST_MAX_STALE_SEC 300UL             // Longest a change to the persistent data waits in RAM while we stay awake
+#define EEPROM_WRITE_TIMEOUT_MS 20UL            // Give up acknowledge polling after this long - the 24XX02 write cycle is 5ms at most
+#define LOW_BATTERY_POWER_DOWN_SEC 255          // deepPowerDown() time when the battery is critical - the AB1805 countdown tops out at 255 seconds
+#define LOW_BATTERY_CHECK_SEC 60UL              // While the fuel gauge alert pin is active the battery is re-measured this often
+
+/**  Gateway Time Sync  **/
+#define SYNC_AIRTIME_MS 60UL                    // Time on air for the sync message from the gateway
+#define SYNC_HOP_LATENCY_MS 75UL                // Added by each repeater hop (receive, process, re-transmit)
+#define SYNC_RETRY_MS 250UL                     // Ack timeout and back-off added by each retransmission
+#define REPORT_GUARD_MS 100UL                   // Quiet time at the start of the reporting window - covers residual clock error
+#define REPORT_SLOT_MS 500UL                    // Each node's share of the reporting window
+#define REPORT_MAX_NODES 32                     // Slots in the reporting window
 
 /******************************************************************************************************/
 /**                                                                                                  **/
@@ -64,6 +77,34 @@
 */
 #define TAP_SENSOR_DEFUALT_SENSITIVITY 5
 #define TAP_SENSOR_DEFUALT_DEBOUNCE_MINNUTES 1
+#define TAP_SENSOR_HOLDOFF_MS 5000UL               // After a tap the interrupt is masked for this long so a burst is one event (0 disables)
+#define TAP_SENSOR_HOLDOFF_POLL_MS 100UL            // PULSE_SRC poll while in the holdoff - well inside the 1s pulse latency so every latched tap is read
+#define AMBIENT_AUTO_THRESHOLD 1                    // Learn the background vibration and set the tap thresholds above it (overrides sensitivity)
+#define AMBIENT_QUIET_MS 10000UL                    // Only sample when there has been no tap for this long
+#define AMBIENT_SAMPLE_MS 1000UL                    // Time between noise floor samples
+#define AMBIENT_MIN_SAMPLES 60                      // Samples needed before the thresholds are changed
+#define AMBIENT_UPDATE_SAMPLES 60                   // Recalculate the thresholds after this many new samples
+#define AMBIENT_FILTER_SHIFT 5                      // Running statistics weight new samples by 1/2^shift
+#define AMBIENT_FLOOR_MULTIPLIER 4                  // Threshold is this many times the floor (mean absolute deviation) ...
+#define AMBIENT_MARGIN_COUNTS 64                    // ... plus this margin in raw counts (~1mg each at 2g)
+#define PRESENCE_ENTER_EVENTS 2                     // Number of taps needed to start an occupancy period ...
+#define PRESENCE_ENTER_WINDOW_SEC 30                // ... within this many seconds - a single bump does not count
+
+
+/*******************************************/
+/**      Presence Fusion Configuration    **/
+/*******************************************/
+/*
+  *  Presence can be sensed by more than one detector (Accelerometer, PIR).  The fusion engine combines their events
+  *  Rules: 0 - any detector, 1 - k of the n enabled detectors, 2 - weighted evidence that decays over the window
+*/
+#define FUSION_DEFAULT_RULE 0                       // Any-of keeps today's behaviour with a single tap sensor
+#define FUSION_DEFAULT_WINDOW_SEC 60                // How long (in seconds) an event counts as evidence
+#define FUSION_DEFAULT_K 2                          // Number of detectors that must agree for the k-of-n rule
+#define FUSION_DEFAULT_WEIGHT_THRESHOLD 60          // Confidence (0-100) needed for the weighted rule
+
+/**  Presence Debugging Flags  **/
+#define PRESENCE_LATENCY_TRACE 1                    // Timestamps the path from the sensor interrupt to the occupancy state change - dumped on a User Switch wake
 
 
 
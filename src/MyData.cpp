@@ -1,5 +1,8 @@
 #include "MyData.h"
 #include "Config.h"
+#include "timing.h"
+#include "rtcStore.h"
+#include "sysSchema.h"
 
 //Define necassary subclasses used within this singleton class:
 ExternalEEPROM myMem;
@@ -12,6 +15,169 @@ sysStatusData *sysStatusData::_instance;
 
 uint8_t writeStatus = 0;
 
+// Write cycles are not waited out when they are issued - the next EEPROM access polls for the acknowledge instead
+static bool writePending = false;
+static uint32_t writeIssuedUs = 0;
+static bool writeTimed = false;                         // Cleared if we slept during the cycle - micros() stops with the clock
+static latencyStats writeCycleStats;                    // Write issued to acknowledge - how long the 24XX02 was busy
+static latencyStats writeStallStats;                    // Time actually spent polling - what persistence adds to awake time
+static uint16_t writeErrors = 0;                        // Writes the device refused and write cycles that never finished
+
+// Every write goes through eepromWrite() so the mirror always matches the device - boot parses from RAM
+static uint8_t mirror[EEPROM_SIZE];
+static bool mirrorLoaded = false;
+
+/**
+ * @brief Little-endian helpers for the hand-packed records
+ */
+static void packLE(uint8_t *dst, uint32_t value, uint8_t size) {
+    for (uint8_t b = 0; b < size; b++) dst[b] = (value >> (8 * b)) & 0xFF;
+}
+
+static uint32_t unpackLE(const uint8_t *src, uint8_t size) {
+    uint32_t value = 0;
+    for (uint8_t b = 0; b < size; b++) value |= (uint32_t)src[b] << (8 * b);
+    return value;
+}
+
+/**
+ * @brief Logs one field - signed and unsigned types are printed as such
+ */
+template <typename T> static void printField(const char *name, T value) {
+    if ((T)-1 < (T)0) Log.infoln("%s: %l", name, (long)value);
+    else Log.infoln("%s: %u", name, (unsigned long)value);
+}
+
+static_assert(1 + SYS_IMAGE_SIZE <= SYS_BANK_CRC_OFFSET, "The system data image no longer fits in a bank");
+
+/**
+ * @brief Picks the newer of two adjacent banks whose CRC-16 (in the last two bytes of the bank) checks out
+ * 
+ * @returns 0 or 1, or -1 if neither bank is valid
+ */
+static int newestBank(const uint8_t *banks, uint8_t bankSize) {
+    int newest = -1;
+    for (uint8_t b = 0; b < 2; b++) {
+        const uint8_t *bank = &banks[b * bankSize];
+        uint16_t crc = bank[bankSize - 2] | (bank[bankSize - 1] << 8);
+        if (crc != rtcStore::crc16(bank, bankSize - 2)) continue;
+        if (newest < 0 || (int8_t)(bank[0] - banks[newest * bankSize]) > 0) newest = b;
+    }
+    return newest;
+}
+
+// Within a page the write spans the first to the last changed byte, so a page costs one write cycle no
+// matter how many of its bytes changed.
+bool writeChangedPages(uint16_t addr, const uint8_t *data, uint8_t *image, size_t len, uint8_t &pages) {
+    size_t i = 0;
+    while (i < len) {
+        size_t pageEnd = ((addr + i) / EEPROM_PAGE_SIZE + 1) * EEPROM_PAGE_SIZE - addr;   // Offset of the next page boundary
+        if (pageEnd > len) pageEnd = len;
+
+        size_t first = pageEnd, last = 0;
+        for (size_t j = i; j < pageEnd; j++) {
+            if (data[j] != image[j]) {
+                if (first == pageEnd) first = j;
+                last = j;
+            }
+        }
+        if (first < pageEnd) {
+            if (!eepromWrite(addr + first, &data[first], last - first + 1)) return false;
+            memcpy(&image[first], &data[first], last - first + 1);
+            pages++;
+        }
+        i = pageEnd;
+    }
+    return true;
+}
+
+// Address 0 once held STRUCTURES_VERSION - the marker says the version now travels in each bank and the journal
+// area holds journal records.  Written last, once a bank and the journal both hold this layout.
+static void storeLayoutMarker() {
+    const uint8_t marker = SYS_LAYOUT_BANKED;
+    eepromWrite(0, &marker, 1);
+}
+
+// Zeroes every journal slot - a zeroed page never passes the CRC, so nothing the area held before can be loaded
+static bool clearJournal() {
+    uint8_t image[JOURNAL_END - JOURNAL_START];
+    uint8_t zero[JOURNAL_END - JOURNAL_START];
+    uint8_t pages = 0;
+    eepromRead(JOURNAL_START, image, sizeof(image));
+    memset(zero, 0, sizeof(zero));
+    return writeChangedPages(JOURNAL_START, zero, image, sizeof(zero), pages);
+}
+
+bool eepromWrite(uint16_t addr, const uint8_t *data, size_t len) {
+    while (len) {
+        size_t chunk = EEPROM_PAGE_SIZE - addr % EEPROM_PAGE_SIZE;     // The library would not wait between pages with polling off
+        if (chunk > len) chunk = len;
+        if (!eepromWaitReady()) return false;                           // The page before may not have been written - stop here
+        int status = myMem.write(addr, (uint8_t *)data, chunk);
+        writeIssuedUs = micros();
+        writePending = true;                                            // Even a failed write may have started a cycle
+        writeTimed = true;
+        if (status != 0) {
+            Log.infoln("EEPROM write at %d failed with status %d", addr, status);
+            writeErrors++;
+            return false;
+        }
+        if (mirrorLoaded) memcpy(&mirror[addr], data, chunk);           // Only once the device has taken the data
+        addr += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+    return true;
+}
+
+void eepromLoad() {
+    eepromWaitReady();
+    myMem.read(0, mirror, EEPROM_SIZE);                                 // Sequential read - the address auto-increments across pages
+    mirrorLoaded = true;
+}
+
+void eepromRead(uint16_t addr, uint8_t *data, size_t len) {
+    if (mirrorLoaded) {
+        memcpy(data, &mirror[addr], len);
+        return;
+    }
+    eepromWaitReady();
+    myMem.read(addr, data, len);
+}
+
+bool eepromWaitReady() {
+    if (!writePending) return true;
+
+    uint32_t start = micros();
+    while (myMem.isBusy()) {                                            // The device NAKs its address until the cycle is done
+        if (micros() - start > EEPROM_WRITE_TIMEOUT_MS * 1000UL) {
+            Log.infoln("EEPROM write cycle did not finish in %l ms", EEPROM_WRITE_TIMEOUT_MS);
+            writeErrors++;
+            writePending = false;
+            return false;
+        }
+    }
+    uint32_t now = micros();
+    if (writeTimed) writeCycleStats.record(now - writeIssuedUs);
+    writeStallStats.record(now - start);
+    writePending = false;
+    return true;
+}
+
+void eepromOverlapSleep() {
+    writeTimed = false;                                                 // Still pending - a wake inside the cycle has to poll
+}
+
+void eepromPrintStats() {
+    writeCycleStats.print("EEPROM write cycle");
+    writeStallStats.print("EEPROM blocked");
+    Log.infoln("EEPROM writes that failed or did not finish: %d", writeErrors);
+}
+
+uint16_t eepromErrorCount() {
+    return writeErrors;
+}
+
 // [static]
 sysStatusData &sysStatusData::instance() {
     if (!_instance) {
@@ -21,6 +187,8 @@ sysStatusData &sysStatusData::instance() {
 }
 
 sysStatusData::sysStatusData() {   
+    writeCycleStats.reset();
+    writeStallStats.reset();
 }
 
 sysStatusData::~sysStatusData() {
@@ -33,51 +201,60 @@ bool sysStatusData::setup() {
     //   myMem.setAddressBytes(1);
 
     myMem.setPageSizeBytes(8);
-    myMem.setMemorySizeBytes(256);
+    myMem.setMemorySizeBytes(EEPROM_SIZE);
+    myMem.disablePollForWriteComplete();                                // eepromWaitReady() polls, and only when the next access needs it
+    myMem.setWriteTimeMs(0);                                            // No fixed delay after each write either
     if (myMem.begin() == false)
     {
         Log.infoln("Memory module not detected");
         return false;
     }
     else Log.infoln("Memory module started");
+    eepromLoad();                                                       // Banks, journal, archive and legacy areas are all parsed from RAM
 
-    uint8_t versionNumber;
-    myMem.get(0,versionNumber);
+    uint8_t header[1 + sizeof(sysStatus.uniqueID)];
+    eepromRead(0, header, sizeof(header));
+    uint8_t versionNumber = header[0];
+    layoutBanked = (versionNumber == SYS_LAYOUT_BANKED);
     Log.infoln("Version number: %d",versionNumber);
 
     // We will retrieve the system unique ID from the memory - this is something that 
     // is set by the gateway and is unique to each node.
     // The unique ID is made of a combination of two random bytes and two time bytes
-    if (myMem.read(1) == 255 || myMem.read(2) == 255) {                            // If the first byte is 255, then the memory has not been initialized
+    if (header[1] == 255 || header[2] == 255) {                            // If the first byte is 255, then the memory has not been initialized
         Log.infoln("This is a virgin node, need to get a unique ID from the gateway");
         sysStatus.uniqueID = 0xFFFFFFFF;  // Four byte number that will signal that we need a unique ID from the gateway
     }
     else {
-        myMem.get(1,sysStatus.uniqueID);
+        memcpy(&sysStatus.uniqueID, &header[1], sizeof(sysStatus.uniqueID));
     }
 
-    if (versionNumber != STRUCTURES_VERSION) {
-        Log.infoln("Structure changed from %i to %i",versionNumber,STRUCTURES_VERSION);
-        sysStatusData::initialize();
+    uint8_t legacy[LEGACY_CURRENT_ADDR - LEGACY_SYS_ADDR];              // Room the structure had before the current data
+    const sysSchema::version *legacySchema = sysSchema::find(versionNumber);
+    int newest = sysStatusData::loadBanks();
+
+    if (newest >= 0) {
+        Log.infoln("System Data found in bank %c", 'A' + newest);
+        sysStatusData::loadImage(&bankImage[newest][1], bankImage[newest][1]);          // Every image starts with its version
+    }
+    else if (versionNumber != SYS_LAYOUT_BANKED && legacySchema && legacySchema->imageSize <= sizeof(legacy)) {   // Written before the banks existed - carry it over
+        Log.infoln("No valid System Data bank - migrating from address %d", LEGACY_SYS_ADDR);
+        eepromRead(LEGACY_SYS_ADDR, legacy, legacySchema->imageSize);
+        eepromRead(LEGACY_CURRENT_ADDR, (uint8_t *)&current, sizeof(current));   // Bank B covers it - currentStatusData journals it from RAM
+        migratedFromLegacy = true;
+        activeBank = 0;                                                 // Bank B first - it is clear of the legacy structure at LEGACY_SYS_ADDR
+        sysStatusData::loadImage(legacy, versionNumber);               // Until currentStatusData writes the marker a reset migrates again from the intact source
     }
     else {
-        myMem.get(10, sysStatus);
-        Log.infoln("System Data retrieved from EEPROM with node number %i, uniqueID %u and magic number %i", sysStatus.nodeNumber, sysStatus.uniqueID, sysStatus.magicNumber);
+        Log.infoln("Structure changed from %i to %i",versionNumber,STRUCTURES_VERSION);
+        sysStatusData::initialize();
     }
     // sysStatusData::printSysData();
     return true;
 }
 
 void sysStatusData::loop() {
-    static unsigned long lastChecked = 0;
-    if (millis() - lastChecked > 1000) {                // Check for data changes every ten seconds while awake - remember millis are only when awake
-        lastChecked = millis();
-
-       if (sysStatusData::sysDataChanged) {
-           sysStatusData::storeSysData();
-           sysStatusData::sysDataChanged = false;
-       }
-    }
+    // sysDataChanged is acted on by writeBehind - nothing to do here
 }
 
 bool sysStatusData::validate(size_t dataSize) {
@@ -103,55 +280,103 @@ void sysStatusData::initialize() {
     Log.infoln("data initialized");
 
     // Initialize the default value if the structure is reinitialized.
-    // Be careful doing this, because when MyData is extended to add new fields,
-    // the initialize method is not called! This is only called when first
-    // initialized.
+    // When MyData is extended to add new fields this is not called - see migrate()
 
     Log.infoln("Loading system defaults");              // Letting us know that defaults are being loaded
-    sysStatus.nodeNumber = 255;
-    sysStatus.structuresVersion = STRUCTURES_VERSION;
-    sysStatus.magicNumber = 27617;
-    sysStatus.firmwareRelease = 255;                   // This value is set in the main program
-    sysStatus.resetCount = 0;
-    sysStatus.nextConnection = 0;
-    sysStatus.alertCodeNode = 1;
-    sysStatus.alertContextNode = 0;
-    sysStatus.zoneMode = TOF_DEFAULT_ZONE_MODE;
-    sysStatus.interferenceBuffer = TOF_DEFAULT_FLOOR_INTERFERENCE_BUFFER;
-    sysStatus.occupancyCalibrationLoops = TOF_DEFAULT_OCCUPANCY_CALIBRATION_LOOPS;
-    sysStatus.distanceMode = TOF_DEFAULT_DISTANCE_MODE;                       
-    sysStatus.tofDetectionsPerSecond = TOF_DEFAULT_DETECTIONS_PER_SECOND;   
-    sysStatus.debounceMin = 1;                         // Debounce time in minutes for occupancy
-    sysStatus.sensitivity = 1;                         // Sensitivity of the sensor 1 is least and 10 is most
-
+    uint32_t uniqueID = sysStatus.uniqueID;            // setup() took this from the protected copy at address 1
+    sysSchema::applyDefaults((uint8_t *)&sysStatus, sysSchema::nativeLayout());   // Defaults live in SYS_SCHEMA_FIELDS
+    sysStatus.uniqueID = uniqueID;
 
     Log.infoln("Saving new system values, node number %i, uniqueID %u and magic number %i", sysStatus.nodeNumber, sysStatus.uniqueID, sysStatus.magicNumber);
-    myMem.put(0,sysStatus.structuresVersion);
 
     sysStatusData::storeSysData();
     sysStatusData::printSysData();
 }
 
-void sysStatusData::storeSysData() {
-    Log.infoln("sysStatus data changed, writing to EEPROM");
-    myMem.put(10,sysStatus);
+void sysStatusData::loadImage(const uint8_t *image, uint8_t storedVersion) {
+    const sysSchema::version *from = sysSchema::find(storedVersion);
+    if (!from) {
+        Log.infoln("Structure changed from %i to %i and the old layout is unknown",storedVersion,STRUCTURES_VERSION);
+        sysStatusData::initialize();
+        return;
+    }
+
+    uint8_t defaulted = sysSchema::deserialize(image, *from, sysStatus);
+    if (storedVersion == STRUCTURES_VERSION) {
+        Log.infoln("System Data retrieved from EEPROM with node number %i, uniqueID %u and magic number %i", sysStatus.nodeNumber, sysStatus.uniqueID, sysStatus.magicNumber);
+        return;
+    }
+    Log.infoln("System Data migrated from version %i to %i - %i new field(s) defaulted", storedVersion, STRUCTURES_VERSION, defaulted);
+    sysStatusData::storeSysData();
+}
+
+bool sysStatusData::resume(const SystemDataStructure &saved) {
+    myMem.setPageSizeBytes(8);                                          // Sizes are known so begin() skips the detection
+    myMem.setMemorySizeBytes(EEPROM_SIZE);
+    myMem.disablePollForWriteComplete();
+    myMem.setWriteTimeMs(0);
+    if (myMem.begin() == false) {
+        Log.infoln("Memory module not detected");
+        return false;
+    }
+    eepromLoad();                                                       // One read covers the banks and the archive
+    sysStatusData::loadBanks();                                         // The next store needs to know which bank is the older one
+    sysStatus = saved;
+    Log.infoln("System Data resumed from snapshot with node number %i", sysStatus.nodeNumber);
+    return true;
+}
+
+bool sysStatusData::storeSysData() {
+    uint8_t bank[SYS_BANK_SIZE];
+    uint8_t target = activeBank ^ 1;                                    // Overwrite the older copy - the newer one survives a torn write
+    uint16_t addr = (target) ? SYS_BANK_B_ADDR : SYS_BANK_A_ADDR;
+
+    memset(bank, 0, sizeof(bank));
+    bank[0] = bankSeq + 1;
+    sysSchema::serialize(sysStatus, &bank[1]);
+    uint16_t crc = rtcStore::crc16(bank, SYS_BANK_CRC_OFFSET);
+    bank[SYS_BANK_CRC_OFFSET] = crc & 0xFF;
+    bank[SYS_BANK_CRC_OFFSET + 1] = crc >> 8;
+
+    if (!bankImageValid[target]) {
+        for (size_t i = 0; i < SYS_BANK_SIZE; i++) bankImage[target][i] = ~bank[i];   // Contents unknown - forces every page out
+        bankImageValid[target] = true;
+    }
+    uint8_t pages = 0;
+    if (!writeChangedPages(addr, bank, bankImage[target], SYS_BANK_CRC_OFFSET, pages) ||
+        !writeChangedPages(addr + SYS_BANK_CRC_OFFSET, &bank[SYS_BANK_CRC_OFFSET], &bankImage[target][SYS_BANK_CRC_OFFSET], 2, pages)) {   // Commit - only once the data is down
+        bankImageValid[target] = false;                                 // The failed page may hold anything - rewrite the whole bank next time
+        Log.infoln("sysStatus not stored - EEPROM write failed, bank %c still holds the last copy", 'A' + activeBank);
+        return false;
+    }
+
+    activeBank = target;
+    bankSeq = bank[0];
+    Log.infoln("sysStatus data stored, %d page(s) written to bank %c", pages, 'A' + target);
+    return true;
+}
+
+int sysStatusData::loadBanks() {
+    eepromRead(SYS_BANK_A_ADDR, bankImage[0], 2 * SYS_BANK_SIZE);       // Banks are adjacent - one read
+    bankImageValid[0] = bankImageValid[1] = true;
+
+    int newest = newestBank(bankImage[0], SYS_BANK_SIZE);
+    if (newest >= 0) {
+        activeBank = newest;
+        bankSeq = bankImage[newest][0];
+    }
+    return newest;
 }
 
 void sysStatusData::printSysData() {
     Log.infoln("System Data");
-    Log.infoln("Magic Number: %d", sysStatus.magicNumber);
-    Log.infoln("Node Number: %d", sysStatus.nodeNumber);
-    Log.infoln("Device ID: %u", sysStatus.uniqueID);
-    Log.infoln("Structures Version: %d", sysStatus.structuresVersion);
-    Log.infoln("Firmware Release: %d", sysStatus.firmwareRelease);
-    Log.infoln("Reset Count: %d", sysStatus.resetCount);
-    Log.infoln("Next connection: %d", sysStatus.nextConnection);
-    Log.infoln("Alert Code Node: %d", sysStatus.alertCodeNode);
-    Log.infoln("Alert Code Context: %d", sysStatus.alertCodeNode);
+#define SYS_PRINT(id, type, name, offset, size, value) printField(#name, sysStatus.name);
+    SYS_SCHEMA_FIELDS(SYS_PRINT)
+#undef SYS_PRINT
 }
 
 void sysStatusData::updateUniqueID() {
-    myMem.put(1,sysStatus.uniqueID);
+    eepromWrite(1, (const uint8_t *)&sysStatus.uniqueID, sizeof(sysStatus.uniqueID));
     Log.infoln("UniqueID updated to %u and stored in protected space", sysStatus.uniqueID);
 }
 
@@ -161,6 +386,13 @@ void sysStatusData::updateUniqueID() {
 
 currentStatusData *currentStatusData::_instance;
 
+static_assert(JOURNAL_SLOTS < 128, "Journal sequence comparison needs fewer than 128 slots");
+static_assert(JOURNAL_START % EEPROM_PAGE_SIZE == 0, "Journal records must not straddle a page");
+#define JOURNAL_CHECK(type, name, offset, size) \
+    static_assert(size == 0 || (offset >= 1 && offset + size <= JOURNAL_RECORD_SIZE - 1 && size == sizeof(type)), "Journaled " #name " must fit between the sequence and the CRC at its full width");
+CURRENT_FIELDS(JOURNAL_CHECK)
+#undef JOURNAL_CHECK
+
 // [static]
 currentStatusData &currentStatusData::instance() {
     if (!_instance) {
@@ -170,7 +402,7 @@ currentStatusData &currentStatusData::instance() {
 }
 
 currentStatusData::currentStatusData() {
-
+    memset(&currentStruct, 0, sizeof(currentStruct));                   // Only part of the structure is journaled
 }
 
 currentStatusData::~currentStatusData() {
@@ -184,23 +416,20 @@ void currentStatusData::setup() {
 
 }
 
-void currentStatusData::loop() {
-    static unsigned long lastChecked = 0;
-    if (millis() - lastChecked > 1000) {                // Check for data changes every ten seconds while awake - remember millis are only when awake
-        lastChecked = millis();
+void currentStatusData::resume(const CurrentDataStructure &saved) {
+    currentStatusData::loadJournal();                                   // The next append must follow the newest record, not restart at slot 0
+    current = saved;
+}
 
-       if (currentStatusData::currentDataChanged) {
-           currentStatusData::storeCurrentData();
-           currentStatusData::currentDataChanged = false;
-       }
-    }
+void currentStatusData::loop() {
+    // currentDataChanged is acted on by writeBehind - nothing to do here
 }
 
 void currentStatusData::resetEverything() {                             // The device is waking up in a new day or is a new install
-  current.occupancyState = 0;
-  sysStatus.resetCount = 0;                                             // Reset the reset count as well
-  current.occupancyGross = 0;                                           // Reset the counts in FRAM as well
-  current.occupancyNet = 0;
+  currentData.set_occupancyState(0);
+  sysData.set_resetCount(0);                                            // Reset the reset count as well
+  currentData.set_occupancyGross(0);                                    // Reset the counts in FRAM as well
+  currentData.set_occupancyNet(0);
   currentData.storeCurrentData();
 }
 
@@ -218,25 +447,99 @@ bool currentStatusData::validate(size_t dataSize) {
 
 void currentStatusData::initialize() {
     Log.infoln("Initialize Current Data");
-    myMem.get(90,current);
+    bool loaded = false;
+    if (sysData.layoutBanked) loaded = currentStatusData::loadJournal();
+    else clearJournal();                                                // Before the marker the area may hold the legacy layout - nothing in it is trusted
+    if (!loaded) {
+        if (sysData.migratedFromLegacy) {                               // sysStatusData::setup() read the legacy copy before bank B covered it
+            Log.infoln("No current data journal - migrating from address %d", LEGACY_CURRENT_ADDR);
+            currentStatusData::storeCurrentData();                      // First journal record - the legacy copy is no longer written
+        }
+        else {
+            Log.infoln("No current data journal - starting from zero");
+            currentStatusData::resetEverything();
+        }
+    }
     if (current.occupancyNet > current.occupancyGross) {
         Log.infoln("Current values not right - resetting");
         currentStatusData::resetEverything();
     }
+    if (!sysData.layoutBanked && journalLastValid) {                   // A bank and the journal now hold this layout
+        storeLayoutMarker();
+        sysData.layoutBanked = true;
+    }
     Log.infoln("Loading current values, occupancy %i", current.occupancyNet);
 
 }
 
-void currentStatusData::storeCurrentData() {
-    Log.infoln("Storing current data to EEPROM");
+bool currentStatusData::storeCurrentData() {
+    uint8_t record[JOURNAL_RECORD_SIZE];
+
     currentStatusData::currentDataChanged = false;
-    myMem.put(90,current);
+    memset(record, 0, sizeof(record));
+    record[0] = journalSeq + 1;
+#define JOURNAL_PACK(type, name, offset, size) if (size) packLE(&record[offset], (uint32_t)current.name, size);
+    CURRENT_FIELDS(JOURNAL_PACK)
+#undef JOURNAL_PACK
+    if (journalLastValid && memcmp(&record[1], &journalLast[1], JOURNAL_RECORD_SIZE - 2) == 0) return true;   // Nothing that survives a reset changed
+
+    record[JOURNAL_RECORD_SIZE - 1] = crc8(record, JOURNAL_RECORD_SIZE - 1);
+    if (!eepromWrite(JOURNAL_START + journalSlot * JOURNAL_RECORD_SIZE, record, JOURNAL_RECORD_SIZE)) {   // Page aligned - one write cycle
+        Log.infoln("Current data not stored - EEPROM write failed");
+        currentStatusData::currentDataChanged = true;                   // The next flush tries again
+        return false;
+    }
+    Log.infoln("Current data stored to EEPROM journal slot %d (seq %d)", journalSlot, record[0]);
+    journalSeq = record[0];
+    memcpy(journalLast, record, JOURNAL_RECORD_SIZE);
+    journalLastValid = true;
+    journalSlot = (journalSlot + 1) % JOURNAL_SLOTS;
+    return true;
+}
+
+bool currentStatusData::loadJournal() {
+    uint8_t journal[JOURNAL_END - JOURNAL_START];
+    int newest = -1;
+
+    eepromRead(JOURNAL_START, journal, sizeof(journal));                // One sequential read rather than a read per slot
+
+    for (uint8_t slot = 0; slot < JOURNAL_SLOTS; slot++) {
+        const uint8_t *record = &journal[slot * JOURNAL_RECORD_SIZE];
+        if (crc8(record, JOURNAL_RECORD_SIZE - 1) != record[JOURNAL_RECORD_SIZE - 1]) continue;
+        // Sequence numbers wrap - with fewer than 128 slots every valid record is within 127 of the newest one
+        if (newest < 0 || (int8_t)(record[0] - journal[newest * JOURNAL_RECORD_SIZE]) > 0) newest = slot;
+    }
+    if (newest < 0) return false;
+
+    const uint8_t *record = &journal[newest * JOURNAL_RECORD_SIZE];
+    memcpy(journalLast, record, JOURNAL_RECORD_SIZE);
+    journalLastValid = true;
+    journalSeq = record[0];
+    journalSlot = (newest + 1) % JOURNAL_SLOTS;
+#define JOURNAL_UNPACK(type, name, offset, size) if (size) current.name = (type)unpackLE(&record[offset], size);
+    CURRENT_FIELDS(JOURNAL_UNPACK)
+#undef JOURNAL_UNPACK
+    Log.infoln("Current data loaded from journal slot %d (seq %d)", newest, journalSeq);
+    return true;
+}
+
+// [static]
+uint8_t currentStatusData::crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0xFF;                                                 // Init 0xFF so an all-zero page does not check out
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+        }
+    }
+    return crc;
 }
 
 void currentStatusData::printCurrentData() {                    // Need to update this to be dependent on the sensor type
     Log.infoln("Current Data");
-    Log.infoln("OccupancyChange: %i", current.occupancyGross);
-    Log.infoln("Occupancy: %i", current.occupancyNet);
+#define CURRENT_PRINT(type, name, offset, size) printField(#name, current.name);
+    CURRENT_FIELDS(CURRENT_PRINT)
+#undef CURRENT_PRINT
     Log.infoln("Sensor Placement: %s", (sysStatus.placement) ? "Inside" : "Outside");
     Log.infoln("Multiple Entrances: %s", (sysStatus.multi) ? "Yes" : "No");
     Log.infoln("Zone 1 Center SPAD: %s", (sysStatus.multi) ? "Yes" : "No");
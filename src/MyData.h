@@ -16,30 +16,41 @@
 
 Overhead
     Address         Data Type      Variable             Description        
-	00              uint8_t        structureVersion     Varialble that changes when the structure is updated
+	00              uint8_t        layout               SYS_LAYOUT_BANKED once the banks and journal are in use - before that the STRUCTURES_VERSION of the legacy copy
     01-04           uint32_t       uniqueID             Unique identifier for this device - generated by the gateway on first connection
-    05-09           Reserved
-System Data
-	10      	    uint8_t        firmwareRelease              Version of the device firmware (integer - aligned to particle product firmware)
-    11              uint8_t        nodeNumber                   Assigned by the gateway on joining the network
-    12              uint16_t       magicNumber                  Number that validates nodes on a network (all share this number)
-    14              uint16_t       token                        Token to validate the node on the network
-    16              uint32_t       uniqueID                     uniqueID - unique to each device
-	20	            uint8_t        resetCount                   Reset count of device (0-256)
-	21              time_t         lastConnection               last time we successfully connected to the gateway
-    25              time_t         nextConnection               next time we will attempt to connect to the gateway
-	29              uint8_t        alertCodeNode                Alert code from node
-    30              uint8_t        alertContextNode             Alert context from node
-    31      	    uint8_t        sensorType                   PIR sensor, car counter, others - this value is changed by the Gateway
-    32              uint8_t        space                        The identifier for the "space", a numerical designation (0-63) for the location that the node is in
-    33              uint8_t        placement                    0 for outside, 1 for inside - determines whether we count up or down
-    34              uint8_t        multi                        0 for single entrance, 1 for multi entrance
-    35              uint8_t        zoneMode                     The predefined SPAD configuration of a ToF Sensor. See Config.h for a description of the zone modes.
-    36              uint8_t        interferenceBuffer           The floor interference buffer of a ToF Sensor.
-    37              uint8_t        occupancyCalibrationLoops    The number of calibration loops to execute for a ToF Sensor during calibration.
-    38              uint8_t        distanceMode                 The distance mode for the TOF sensor. 0 = short (up to 1.3m), 1 = medium (up to 3m), 2 = long (up to 4m)
-    39-49           Reserved
-Current Data
+    05-07           Reserved
+System Data Banks (two alternating copies - boot takes the newest one whose CRC checks out)
+    08-55           Bank A
+    56-103          Bank B
+                    00      uint8_t     sequence        Wraps - compared the same way as the journal
+                    01-45   image                       SystemDataStructure packed little-endian - layout below, see sysSchema.h
+                    46-47   uint16_t    crc16           CRC-16/CCITT-FALSE over 00-45 - written last, so it commits the bank
+System Data Image (STRUCTURES_VERSION 19 - offsets within the image, no padding)
+    00              uint8_t        structuresVersion            Layout of the rest of the image
+    01              uint8_t        firmwareRelease              Version of the device firmware (integer - aligned to particle product firmware)
+    02              uint16_t       magicNumber                  Number that validates nodes on a network (all share this number)
+    04              uint8_t        nodeNumber                   Assigned by the gateway on joining the network
+    05              uint16_t       token                        Token to validate the node on the network
+    07              uint32_t       uniqueID                     uniqueID - unique to each device
+    11              uint8_t        resetCount                   Reset count of device (0-256)
+    12              uint32_t       lastConnection               last time we successfully connected to the gateway (Unix seconds)
+    16              uint32_t       nextConnection               next time we will attempt to connect to the gateway (Unix seconds)
+    20              uint8_t        alertCodeNode                Alert code from node
+    21              uint16_t       alertContextNode             Alert context from node
+    23              uint8_t        sensorType                   PIR sensor, car counter, others - this value is changed by the Gateway
+    24              uint8_t        space                        The identifier for the "space", a numerical designation (0-63) for the location that the node is in
+    25              uint8_t        placement                    0 for outside, 1 for inside - determines whether we count up or down
+    26              uint8_t        multi                        0 for single entrance, 1 for multi entrance
+    27              uint8_t        zoneMode                     The predefined SPAD configuration of a ToF Sensor. See Config.h for a description of the zone modes.
+    28              uint16_t       interferenceBuffer           The floor interference buffer of a ToF Sensor.
+    30              uint16_t       occupancyCalibrationLoops    The number of calibration loops to execute for a ToF Sensor during calibration.
+    32              uint8_t        distanceMode                 The distance mode for the TOF sensor. 0 = short (up to 1.3m), 1 = medium (up to 3m), 2 = long (up to 4m)
+    33              uint8_t        tofDetectionsPerSecond       Detections per second in detection mode on the TOF sensor
+    34              uint8_t        sensitivity                  For Tap sensor / Presence - sensitivty of the detector
+    35              uint8_t        debounceMin                  For Tap sensor / Presence - minutes after a tap before we declare no presence
+Earlier layouts (read once to migrate older devices)
+    10-             SystemDataStructure as laid out by the compiler, before the banks
+Legacy Current Data (read once to migrate older devices - now overlaid by bank B)
     90              int8_t         internalTempC;       Enclosure temperature in degrees C
     94              int8_t         internalHumidity     Enclosure humidity in percent
 	98      	    int8_t         stateOfCharge        Battery charge level
@@ -49,6 +60,20 @@ Current Data
 	110             uint16_t       occupancyGross       Change in occupancy since last report
 	113             uint16_t       occupancyNet         Current occupancy count
     115             uint8_t        occupancyState       Allows us to monitor occupancy state across functions
+Current Data Journal
+    104-151         6 x 8 byte records, one per page, written round-robin
+                    Each page takes one append in six - 6,000,000 appends at the 24XX02's 1,000,000 cycle rating,
+                    or 1,600 a day for ten years.  writeBehind appends at most once every PERSIST_MAX_STALE_SEC
+                    while awake (288 a day) plus once per sleep when something changed.
+                    00  uint8_t    sequence             Wraps - the newest record is the one no other valid record is newer than
+                    01  uint16_t   occupancyGross
+                    03  int16_t    occupancyNet
+                    05  uint8_t    occupancyState
+                    06  uint8_t    batteryState
+                    07  uint8_t    crc8                 CRC-8 (poly 0x07, init 0xFF) over bytes 0-6 - erased or zeroed pages never pass
+Daily Occupancy Archive
+    152-159         Header - magic, days stored, oldest day, oldest slot, CRC-16 (see dailyArchive.h)
+    160-255         Ring of 32 x 3 byte day records
 */
 
 #ifndef __MYDATA_H
@@ -58,11 +83,123 @@ Current Data
 #include <arduino.h>
 #include <ArduinoLog.h>
 #include "SparkFun_External_EEPROM.h" // Click here to get the library: http://librarymanager/All#SparkFun_External_EEPROM
-
-#define STRUCTURES_VERSION 18                           // Version of the data structures (system and data)
+#include "latencyStats.h"
+
+#define STRUCTURES_VERSION 19                           // Version of the data structures (system and data)
+
+#define SYS_LAYOUT_BANKED 0xFE                          // Address 0 - the version now travels in each bank
+
+#define EEPROM_SIZE 256                                 // 24XX02 - mirrored in RAM, see eepromLoad()
+#define EEPROM_PAGE_SIZE 8                              // 24XX02 - a write within one page costs a single write cycle
+#define SYS_BANK_A_ADDR 8                               // Page aligned
+#define SYS_BANK_SIZE 48                                // Sequence, up to 45 bytes of packed image and the CRC
+#define SYS_BANK_B_ADDR (SYS_BANK_A_ADDR + SYS_BANK_SIZE)
+#define SYS_BANK_CRC_OFFSET (SYS_BANK_SIZE - 2)
+#define LEGACY_SYS_ADDR 10                              // Where storeSysData() used to write the whole structure
+#define LEGACY_CURRENT_ADDR 90                          // Where storeCurrentData() used to write the whole structure
+#define JOURNAL_START (SYS_BANK_B_ADDR + SYS_BANK_SIZE)
+#define JOURNAL_END 152                                 // Six slots - see the write-cycle budget above
+#define ARCHIVE_START JOURNAL_END                       // dailyArchive - see dailyArchive.h
+#define ARCHIVE_END EEPROM_SIZE
+#define JOURNAL_RECORD_SIZE EEPROM_PAGE_SIZE
+#define JOURNAL_SLOTS ((JOURNAL_END - JOURNAL_START) / JOURNAL_RECORD_SIZE)
+
+// System data schema - the one place a field is declared.  It generates SystemDataStructure, the get_/set_
+// accessors, printSysData() and (in sysSchema.cpp) the stored image layout.
+// id (permanent - never reuse), type, name, offset and size in the packed little-endian image, default value
+#define SYS_SCHEMA_FIELDS(X) \
+    X(1,  uint8_t,  structuresVersion,          0,  1, STRUCTURES_VERSION)                          /* Version of the data structures (system and data) */ \
+    X(2,  uint8_t,  firmwareRelease,            1,  1, 255)                                         /* Version of the device firmware - set in the main program */ \
+    X(3,  uint16_t, magicNumber,                2,  2, 27617)                                       /* A way to identify nodes and gateways so they can trust each other */ \
+    X(4,  uint8_t,  nodeNumber,                 4,  1, 255)                                         /* Assigned by the gateway on joining the network */ \
+    X(5,  uint16_t, token,                      5,  2, 0)                                           /* Token to validate the node on the network */ \
+    X(6,  uint32_t, uniqueID,                   7,  4, 0xFFFFFFFF)                                  /* uniqueID - unique to each device */ \
+    X(7,  uint8_t,  resetCount,                 11, 1, 0)                                           /* reset count of device (0-256) */ \
+    X(8,  time_t,   lastConnection,             12, 4, 0)                                           /* Last time we successfully connected to the gateway */ \
+    X(9,  time_t,   nextConnection,             16, 4, 0)                                           /* When is the next connection */ \
+    X(10, uint8_t,  alertCodeNode,              20, 1, 1)                                           /* Alert code from node */ \
+    X(11, uint16_t, alertContextNode,           21, 2, 0)                                           /* Alert context from node */ \
+    X(12, uint8_t,  sensorType,                 23, 1, 0)                                           /* PIR sensor, car counter, accelerometer, others - changed by the Gateway */ \
+    X(13, uint8_t,  space,                      24, 1, 0)                                           /* Assciates the node with a space - changed by the Gateway */ \
+    X(14, uint8_t,  placement,                  25, 1, 0)                                           /* 0 for outside, 1 for inside - changed by the Gateway */ \
+    X(15, uint8_t,  multi,                      26, 1, 0)                                           /* 1 if the room has more than one entrance - changed by the Gateway */ \
+    X(16, uint8_t,  zoneMode,                   27, 1, TOF_DEFAULT_ZONE_MODE)                       /* The predefined SPAD configuration of a ToF Sensor */ \
+    X(17, uint16_t, interferenceBuffer,         28, 2, TOF_DEFAULT_FLOOR_INTERFERENCE_BUFFER)       /* The floor interference buffer of a ToF Sensor */ \
+    X(18, uint16_t, occupancyCalibrationLoops,  30, 2, TOF_DEFAULT_OCCUPANCY_CALIBRATION_LOOPS)     /* Calibration loops for a ToF Sensor */ \
+    X(19, uint8_t,  distanceMode,               32, 1, TOF_DEFAULT_DISTANCE_MODE)                   /* 0 = short (up to 1.3m), 1 = medium (up to 3m), 2 = long (up to 4m) */ \
+    X(20, uint8_t,  tofDetectionsPerSecond,     33, 1, TOF_DEFAULT_DETECTIONS_PER_SECOND)           /* Detections per second in detection mode on the TOF sensor */ \
+    X(21, uint8_t,  sensitivity,                34, 1, 1)                                           /* For Tap sensor / Presence - sensitivty of the detector */ \
+    X(22, uint8_t,  debounceMin,                35, 1, 1)                                           /* For Tap sensor / Presence - minutes after a tap before we declare no presence */
+
+#define SYS_IMAGE_SIZE 36                               // Bytes in a STRUCTURES_VERSION image - checked against the table at compile time
+
+// Current data schema - generates CurrentDataStructure, the accessors and printCurrentData()
+// type, name, offset and size in the journal record (size 0 - not journaled, the value is measured again after a reset)
+#define CURRENT_FIELDS(X) \
+    X(int8_t,   internalTempC,      0, 0)               /* Enclosure temperature in degrees C */ \
+    X(int8_t,   internalHumidity,   0, 0)               /* Enclosure humidity in percent */ \
+    X(int8_t,   stateOfCharge,      0, 0)               /* Battery charge level */ \
+    X(uint8_t,  batteryState,       6, 1)               /* Stores the current battery state (low, charging, discharging, etc) */ \
+    X(int16_t,  RSSI,               0, 0)               /* Latest signal strength value (updated after ack and sent to gateway on next data report) */ \
+    X(int16_t,  SNR,                0, 0)               /* Latest Signal to Noise Ratio (updated after ack and sent to gateway on next data report) */ \
+    X(uint16_t, occupancyGross,     1, 2)               /* Sum of occupancy changes for the day */ \
+    X(int16_t,  occupancyNet,       3, 2)               /* Current occupancy count */ \
+    X(uint8_t,  occupancyState,     5, 1)               /* Allows us to monitor occupancy state across functions */
 
 //Macros(#define) to swap out during pre-processing (use sparingly). This is typically used outside of this .H and .CPP file within the main .CPP file or other .CPP files that reference this header file. 
 // This way you can do "data.setup()" instead of "MyPersistentData::instance().setup()" as an example
+extern ExternalEEPROM myMem;                            // Defined in MyData.cpp - shared with dailyArchive
+
+/**
+ * @brief Writes only the bytes of data that differ from image, one write per EEPROM page that changed - image is updated to match
+ * 
+ * @param pages - incremented for each page write issued
+ * 
+ * @returns false if a write failed - the pages after it are not written
+ */
+bool writeChangedPages(uint16_t addr, const uint8_t *data, uint8_t *image, size_t len, uint8_t &pages);
+
+/**
+ * @brief Starts a write and returns without waiting for the write cycle - split at page boundaries, each page waits for the one before
+ * 
+ * @returns false if the write cycle before a page did not finish or the device refused the page - the rest are
+ * not written, and the mirror keeps what the device last took
+ */
+bool eepromWrite(uint16_t addr, const uint8_t *data, size_t len);
+
+/**
+ * @brief Reads the whole EEPROM into the RAM mirror in one sequential read - called once the device has begun
+ */
+void eepromLoad();
+
+/**
+ * @brief Reads from the RAM mirror once it is loaded, otherwise from the device once any write cycle in progress is done
+ */
+void eepromRead(uint16_t addr, uint8_t *data, size_t len);
+
+/**
+ * @brief Acknowledge polling - returns as soon as the 24XX02 finishes the write cycle in progress
+ * 
+ * @returns false if the device did not answer within EEPROM_WRITE_TIMEOUT_MS
+ */
+bool eepromWaitReady();
+
+/**
+ * @brief Stops timing the write cycle in progress - micros() stops with the clock while we sleep.  The cycle stays
+ * pending, so an access after a short sleep still polls for the acknowledge.
+ */
+void eepromOverlapSleep();
+
+/**
+ * @brief Logs the write cycle and blocked time histograms and the write error count
+ */
+void eepromPrintStats();
+
+/**
+ * @brief Number of write cycles that did not finish within EEPROM_WRITE_TIMEOUT_MS since boot
+ */
+uint16_t eepromErrorCount();
+
 #define currentData currentStatusData::instance()
 #define sysData sysStatusData::instance()
 #define sysStatus sysStatusData::instance().sysStatusStruct
@@ -115,9 +252,8 @@ public:
 	/**
 	 * @brief Will reinitialize data if it is found not to be valid
 	 * 
-	 * Be careful doing this, because when MyData is extended to add new fields,
-	 * the initialize method is not called! This is only called when first
-	 * initialized.
+	 * Loads the defaults from SYS_SCHEMA_FIELDS.  When MyData is extended with new fields
+	 * this is not called - migrate() defaults just the new fields and keeps the rest.
 	 * 
 	 */
 	void initialize();
@@ -125,8 +261,9 @@ public:
     /**
      * @brief Stores the system data to EEPROM to facilitate recover after a power cycle or reset
      * 
+     * @returns false if a write failed - the CRC is not written so the other bank stays the newest
     */
-    void storeSysData();
+    bool storeSysData();
 
     /**
      * @brief Prints system data in a readable format for Serial Montitor
@@ -143,33 +280,30 @@ public:
 
 	struct SystemDataStructure
 	{
-        uint8_t structuresVersion;                        // Version of the data structures (system and data)
-        uint8_t firmwareRelease;                          // Version of the device firmware (integer - aligned to particle product firmware)
-        uint16_t magicNumber;							  // A way to identify nodes and gateways so they can trust each other
-        uint8_t nodeNumber;                               // Assigned by the gateway on joining the network
-        uint16_t token;                                   // Token to validate the node on the network
-        uint32_t uniqueID;                                // uniqueID - unique to each device
-		uint8_t resetCount;                               // reset count of device (0-256)
-		time_t lastConnection;                     		  // Last time we successfully connected to Particle
-		time_t nextConnection;                            // When is the next connection
-		uint8_t alertCodeNode;                            // Alert code from node
-        uint16_t alertContextNode;                        // Alert context from node
-        uint8_t sensorType;                               // PIR sensor, car counter, accelerometer, others - this value is changed by the Gateway
-        uint8_t space;                                    // Assciates the node with a space - this value is changed by the Gateway
-        uint8_t placement;                                // 0 for outside, 1 for inside - determines whether we count up or down - this value is changed by the Gateway
-        uint8_t multi;                                    // 1 if this device is taking occupancy of a room with more than one entrance, prevents negative counts - this value is changed by the Gateway
-        uint8_t zoneMode;                                 // The predefined SPAD configuration of a ToF Sensor. See Config.h for a description of the zone modes.
-        uint16_t interferenceBuffer;                      // The floor interference buffer of a ToF Sensor.
-        uint16_t occupancyCalibrationLoops;               // The number of calibration loops to execute for a ToF Sensor during calibration.
-        uint8_t distanceMode;                             // The distance mode for a TOF sensor asset. 0 = short (up to 1.3m), 1 = medium (up to 3m), 2 = long (up to 4m)
-        uint8_t tofDetectionsPerSecond;                   // The number of detections to make per second when in detection mode on the TOF sensor
-        uint8_t sensitivity;                              // For Tap sensor / Presence - sensitivty of the detector
-        uint8_t debounceMin;                              // For Tap sensor / Presence - many minutes after a tap before we declare no presence
+#define SYS_STRUCT_FIELD(id, type, name, offset, size, value) type name;
+        SYS_SCHEMA_FIELDS(SYS_STRUCT_FIELD)
+#undef SYS_STRUCT_FIELD
     };
 	SystemDataStructure sysStatusStruct;
 
+    // get_name() and set_name() for every field - a setter that changes the value flags the data for writeBehind
+#define SYS_ACCESSORS(id, type, name, offset, size, value) \
+    type get_##name() const { return sysStatusStruct.name; } \
+    void set_##name(type newValue) { if (sysStatusStruct.name != newValue) { sysStatusStruct.name = newValue; sysDataChanged = true; } }
+    SYS_SCHEMA_FIELDS(SYS_ACCESSORS)
+#undef SYS_ACCESSORS
+
+    /**
+     * @brief Fast-resume alternative to setup() - starts the EEPROM without reading it and takes the data from a snapshot
+     * 
+     * Used after an AB1805 deepPowerDown() when rtcSnapshot holds a copy that is newer than the EEPROM.
+     */
+    bool resume(const SystemDataStructure &saved);
+
 public:
-    bool sysDataChanged = false;
+    bool sysDataChanged = false;                          // Written by writeBehind - at sleep, on the staleness deadline or on low battery
+    bool migratedFromLegacy = false;                      // Set when setup() found the pre-bank layout - currentStatusData migrates too
+    bool layoutBanked = false;                            // Address 0 holds SYS_LAYOUT_BANKED - until then currentStatusData does not trust the journal area
 
 	//Members here are internal only and therefore protected
 protected:
@@ -201,12 +335,31 @@ protected:
      * The object pointer to this class is stored here. It's NULL at system boot.
      */
     static sysStatusData *_instance;
-    
+
+    /**
+     * @brief Reads both banks in one pass and keeps them as the images storeSysData() diffs against
+     * 
+     * @returns the newest bank with a good CRC, or -1 if neither is valid
+     */
+    int loadBanks();
+
+    /**
+     * @brief Unpacks a stored image into sysStatus - an older STRUCTURES_VERSION is brought forward field by field and stored again
+     * 
+     * Falls back to initialize() if the layout is not in the schema history - see sysSchema.h
+     */
+    void loadImage(const uint8_t *image, uint8_t storedVersion);
+
+    uint8_t bankImage[2][SYS_BANK_SIZE];                  // What each bank holds in EEPROM - storeSysData() only writes the pages that differ
+    bool bankImageValid[2] = {false, false};
+    uint8_t activeBank = 1;                               // Bank holding the newest copy - the first write goes to bank A
+    uint8_t bankSeq = 0;
 };
 
 
 
 
+
 // *****************  Current Status Storage Object *******************
 //
 // ********************************************************************
@@ -266,9 +419,11 @@ public:
     /**
      * @brief Stores relevant current data (not all the current struct - only the stuff that needs to surve a reset)
      * 
-     * We will need to trigger this with a flag when any of the relevant values change.
+     * Appends one record to the journal - a single page write - so each page sees only 1/JOURNAL_SLOTS of the updates.
+     * 
+     * @returns false if the write failed - currentDataChanged is left set so the next flush tries again
     */
-    void storeCurrentData();
+    bool storeCurrentData();
 
     /**
      * @brief Prints current data in a readable format for Serial Montitor
@@ -277,21 +432,26 @@ public:
 
 	struct CurrentDataStructure
 	{
-        int8_t internalTempC;                             // Enclosure temperature in degrees C
-        int8_t internalHumidity;                          // Enclosure humidity in percent
-		int8_t stateOfCharge;                             // Battery charge level
-		uint8_t batteryState;                             // Stores the current battery state (low, charging, discharging, etc)
-		int16_t RSSI;                                     // Latest signal strength value (updated adter ack and sent to gateway on next data report)
-		int16_t SNR;									  // Latest Signal to Noise Ratio (updated after ack and send to gatewat on next dara report)
-		uint16_t occupancyGross;                          // Sum of occupancy changes for the day
-        int16_t occupancyNet;                             // Current occupancy count
-        uint8_t occupancyState;                           // Allows us to monitor occupancy state across functions
-		// OK to add more fields here 
+#define CURRENT_STRUCT_FIELD(type, name, offset, size) type name;
+        CURRENT_FIELDS(CURRENT_STRUCT_FIELD)                 // OK to add more fields to CURRENT_FIELDS
+#undef CURRENT_STRUCT_FIELD
 	};
 	CurrentDataStructure currentStruct;
 
+    // get_name() and set_name() for every field - only journaled fields make the data dirty
+#define CURRENT_ACCESSORS(type, name, offset, size) \
+    type get_##name() const { return currentStruct.name; } \
+    void set_##name(type newValue) { if (currentStruct.name != newValue) { currentStruct.name = newValue; if (size) currentDataChanged = true; } }
+    CURRENT_FIELDS(CURRENT_ACCESSORS)
+#undef CURRENT_ACCESSORS
+
+    /**
+     * @brief Fast-resume alternative to setup() - takes the current data from a snapshot and finds the newest journal record to append after
+     */
+    void resume(const CurrentDataStructure &saved);
+
 public:
-    bool currentDataChanged = false;
+    bool currentDataChanged = false;                      // Written by writeBehind - at sleep, on the staleness deadline or on low battery
 
 	//Members here are internal only and therefore protected
 protected:
@@ -323,5 +483,22 @@ protected:
      * The object pointer to this class is stored here. It's NULL at system boot.
      */
     static currentStatusData *_instance;
+
+    /**
+     * @brief Scans the journal for the newest valid record and loads it into current
+     * 
+     * @returns false if the journal holds no valid record
+     */
+    bool loadJournal();
+
+    /**
+     * @brief CRC-8 (poly 0x07, init 0xFF) used to validate journal records
+     */
+    static uint8_t crc8(const uint8_t *data, size_t len);
+
+    uint8_t journalSeq = 0;                               // Sequence number of the newest record
+    uint8_t journalLast[JOURNAL_RECORD_SIZE];             // Newest record - an unchanged payload is not written again
+    bool journalLastValid = false;
+    uint8_t journalSlot = 0;                              // Slot the next record goes in
 };
 #endif  /* __MYDATA_H */
@@ -30,6 +30,9 @@
 #include "stsLED.h"
 #include "take_measurements.h"
 #include "MyData.h"
+#include "rtcSnapshot.h"
+#include "writeBehind.h"
+#include "dailyArchive.h"
 #include "Config.h"
 
 const uint8_t firmwareRelease = 1;
@@ -49,12 +52,12 @@ void wakeUp_Timer();
 // Program Variables	
 volatile uint8_t IRQ_Reason = 0; 										// 0 - Invalid, 1 - AB1805, 2 - RFM95 DIO0, 3 - RFM95 IRQ, 4 - User Switch, 5 - Sensor
 time_t lastEventTime = 0;		
+time_t lastBatteryCheck = 0;
 
 void setup()
 {
 	Wire.begin(); 														// Establish Wire.begin for I2C communication
 	Serial.begin(115200);												// Establish Serial connection if connected for debugging
-	delay(2000);
 
 	gpio.setup(); 														// Setup the pins
  	LED.setup(gpio.STATUS);												// Led used for status
@@ -62,33 +65,46 @@ void setup()
 
 	// Log.begin(LOG_LEVEL_SILENT, &Serial);
 	Log.begin(LOG_LEVEL_INFO, &Serial);
+
+	bool timeSetUp = timeFunctions.setup();								// Also reads the AB1805 wake reason
+	uint8_t resumeState = IDLE_STATE;
+	bool fastResume = snapshot.restore(resumeState);					// Planned wake from deepPowerDown() with a valid snapshot
+	if (!fastResume) delay(2000);										// Give the serial monitor time to connect
+
 	Log.infoln("PROGRAM: See Insights LoRa Node - Accelerometer Test");
 
-	if (sysData.setup()) {												// Set up the system data
-		Log.infoln("System data set up");
-		sysStatus.debounceMin = 1;										// Set the debounce time
-		lastEventTime = timeFunctions.getTime();                    // Record the time of the event
-		currentData.setup();											// Set up current storage objects if the system data is set up
+	if (timeSetUp) {													// Set up the timing functions
+		Log.infoln("Time functions set up");
 	}
 	else {
-		Log.infoln("System data failed to set up");
+		Log.infoln("Time functions failed to set up");
 		state = ERROR_STATE;
 	}
 
-	if (timeFunctions.setup()) {										// Set up the timing functions
-		Log.infoln("Time functions set up");
+	if (fastResume) {													// sysStatus and current came from the snapshot
+		Log.infoln("Fast resume from deep power down");
+		state = (State)resumeState;
+		lastEventTime = timeFunctions.getTime();
+	}
+	else if (sysData.setup()) {											// Set up the system data
+		Log.infoln("System data set up");
+		sysData.set_debounceMin(1);										// Set the debounce time
+		lastEventTime = timeFunctions.getTime();                    // Record the time of the event
+		currentData.setup();											// Set up current storage objects if the system data is set up
 	}
 	else {
-		Log.infoln("Time functions failed to set up");
+		Log.infoln("System data failed to set up");
 		state = ERROR_STATE;
 	}
+	if (state != ERROR_STATE) archive.setup();							// Parses the EEPROM mirror the system data loaded
 
 	if (!measure.setup()) {												// Set up the sensor
 		Log.infoln("Sensor failed to set up");
 		state = ERROR_STATE;
 	}
+	snapshot.resumeSensors();											// Presence state and learned tap thresholds (fast resume only)
 
-	if (!digitalRead(gpio.USER_SW)) {
+	if (!fastResume && !digitalRead(gpio.USER_SW)) {
 		uint32_t startTesting = millis();
 		Log.infoln("User switch detected - 20 seconds to test tap sensitivity");
 		while (millis() - startTesting < 20000UL) {
@@ -101,10 +117,14 @@ void setup()
 		Log.infoln("Time is up - resuming startup");
 	}
 
+	timeFunctions.registerTask(wdtTask_measure, 10000UL, "measure");	// Loops run every few msec - this deadline only catches a wedged task
+
 	LowPower.attachInterruptWakeup(gpio.I2C_INT, sensorISR, RISING);                  	// Accelerometer interrupt from low to high
 	LowPower.attachInterruptWakeup(gpio.USER_SW, userSwitchISR, FALLING);             	// User switch interrupt from high to low
 	LowPower.attachInterruptWakeup(gpio.WAKE, wakeUp_Timer, FALLING);               	// RTC Alarm interrupt from low to high
 
+	timeFunctions.setPeriodicWake(PERIODIC_WAKE_MS);					// Set once - the AB1805 reloads the countdown itself
+
 	Log.infoln("Setup process completed exiting in state %s", stateNames[state]);
 
 	LED.off();                                                     		//  End of the setup routine
@@ -116,6 +136,10 @@ void loop()
   switch (state) {
     case IDLE_STATE:
     	if (state != oldState) publishStateTransition();             	// We will apply the back-offs before sending to ERROR state - so if we are here we will take action
+		if (digitalRead(gpio.BATTINT) == LOW && timeFunctions.getTime() - lastBatteryCheck >= (time_t)LOW_BATTERY_CHECK_SEC) {
+			state = LOW_BATTERY;										// Fuel gauge alert (below 3.7V) - measure and decide whether to power down
+			break;
+		}
 		if (timeFunctions.getTime() - lastEventTime > (sysStatus.debounceMin * 60UL)) {		// If we have been in IDLE for more than the debounce period, go to sleep
 			// state = SLEEPING_STATE; 
 			Log.infoln("In the idle state longer than the debounce period (%d mins)- going to sleep", sysStatus.debounceMin);
@@ -134,24 +158,24 @@ void loop()
 			break;
 		}
 		
-		time_t currentTime = timeFunctions.getTime();					// How long to sleep
-
-    	unsigned long sleepTime = 60UL;                      			// Sleep for 60 seconds
-
-		Log.infoln("Going to sleep for %u seconds", sleepTime);
+		Log.infoln("Going to sleep - periodic wake every %l msec", timeFunctions.getPeriodicWake());	// Queued events wake us sooner through the alarm
 
+		persistence.flush(flushReason_sleep);							// One EEPROM write for everything that changed while awake
 		timeFunctions.stopWDT();  										// No watchdogs interrupting our slumber
 
 		Serial.flush();													// Ensure all serial data is sent
 		Serial.end();													// Close the serial port
 		delay(100);
-		timeFunctions.interruptAtTime(currentTime + sleepTime, 0);      // Set the interrupt for the next event
-		LowPower.sleep((sleepTime + 1) * 1000UL);						// Set the sleep time in milliseconds 
+		Presence::instance().endBurst();								// Re-arm the tap interrupt now rather than waking on a timer to do it
+		LowPower.sleep();												// The RTC (periodic timer or next event) is the only timed wake source
+		presenceLatency.mark(LATENCY_STAGE_WAKE);
+		timeFunctions.resync();											// millis() stood still while we slept - re-anchor the clock
 		Serial.begin(115200);											// Reopen the serial port
 		unsigned long wakeStartTime = millis();
 		while (!Serial) {
 			if (millis() - wakeStartTime > 5000) break;
 		}												// Wait for the serial port to open
+		presenceLatency.mark(LATENCY_STAGE_SERIAL);
 		timeFunctions.resumeWDT();                          			// Wakey Wakey - WDT can resume
 	
 		if (IRQ_Reason == IRQ_Sensor) {
@@ -161,6 +185,8 @@ void loop()
 		}
 		else if (IRQ_Reason == IRQ_UserSwitch) {
 			Log.infoln("Woke up for User Switch");
+			presenceLatency.print();									// Dump the interrupt to detection latency counters
+			eepromPrintStats();											// ... and how long EEPROM writes keep us awake
 			lastEventTime = timeFunctions.getTime();                    // Record the time of the event
 			state = IDLE_STATE;
 		}
@@ -176,7 +202,19 @@ void loop()
     } break;
 
     case LOW_BATTERY:
-    	if (state != oldState) publishStateTransition();
+    	if (state != oldState) {
+			publishStateTransition();
+			persistence.onLowBattery();
+		}
+		lastBatteryCheck = timeFunctions.getTime();
+		measure.takeMeasurements();										// Sets batteryState from the fuel gauge
+		if (current.batteryState == 0) {								// Less than 10% - power the MCU down and resume from the snapshot
+			Log.infoln("Battery critically low - powering down for %d seconds", LOW_BATTERY_POWER_DOWN_SEC);
+			persistence.flush(flushReason_powerDown);
+			snapshot.save(IDLE_STATE);
+			Serial.flush();
+			timeFunctions.deepPowerDown(LOW_BATTERY_POWER_DOWN_SEC);		// Does not return - the next boot is a fast resume
+		}
 		state = IDLE_STATE;												// Logs the low battery state don't get stuck here
     break;
 
@@ -195,9 +233,16 @@ void loop()
     break;
   }
 
+  if (timeFunctions.eventFired(eventFlag_dailyRollover)) {			// New day - start the daily totals over
+	Log.infoln("Daily rollover - archiving and resetting the daily counts");
+	archive.closeDay();
+	currentData.resetEverything();
+  }
+
   measure.loop();                                                   	// Check the sensor
-  currentData.loop();													// Ensure data is stored when needed.
+  currentData.loop();
   sysData.loop();
+  persistence.loop();													// Ensure data is stored when needed - coalesced, see writeBehind.h
   timeFunctions.loop();													// Keep the time up to date
 }
 
@@ -226,4 +271,5 @@ void userSwitchISR() {
 
 void sensorISR() {	
 	IRQ_Reason = IRQ_Sensor;      // and write to IRQ_Reason in order to wake the device up
+	presenceLatency.markInterrupt();
 }
\ No newline at end of file
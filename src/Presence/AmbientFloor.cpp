@@ -0,0 +1,52 @@
+// AmbientFloor Class
+// Author: Chip McClelland
+// Date: October 2024
+// License: GPL3
+// In this class, we estimate the per-axis vibration floor and turn it into tap thresholds
+
+#include "AmbientFloor.h"
+
+// At +/-2g the MMA8452Q reports 1024 counts per g and the pulse threshold is 0.063g (~64 counts) per LSB
+#define COUNTS_PER_THS_LSB 64
+
+AmbientFloor::AmbientFloor() {
+    reset();
+}
+
+void AmbientFloor::reset() {
+    for (uint8_t i = 0; i < AMBIENT_AXES; i++) {
+        meanQ4[i] = 0;
+        devQ4[i] = 0;
+    }
+    samples = 0;
+}
+
+void AmbientFloor::addSample(int16_t x, int16_t y, int16_t z) {
+    addAxis(0, x);
+    addAxis(1, y);
+    addAxis(2, z);
+    if (samples < 0xFFFF) samples++;
+}
+
+void AmbientFloor::addAxis(uint8_t axis, int16_t value) {
+    int32_t valueQ4 = (int32_t)value << 4;
+    if (samples == 0) {                                     // Seed the mean with the first sample (gravity sits on one axis)
+        meanQ4[axis] = valueQ4;
+        return;
+    }
+    int32_t delta = valueQ4 - meanQ4[axis];
+    meanQ4[axis] += delta >> AMBIENT_FILTER_SHIFT;
+    int32_t absDelta = (delta < 0) ? -delta : delta;
+    devQ4[axis] += (absDelta - devQ4[axis]) >> AMBIENT_FILTER_SHIFT;
+}
+
+uint16_t AmbientFloor::floorCounts(uint8_t axis) const {
+    if (axis >= AMBIENT_AXES) return 0;
+    return (uint16_t)((devQ4[axis] + 8) >> 4);
+}
+
+uint8_t AmbientFloor::threshold(uint8_t axis) const {
+    uint32_t counts = (uint32_t)floorCounts(axis) * AMBIENT_FLOOR_MULTIPLIER + AMBIENT_MARGIN_COUNTS;
+    uint32_t ths = (counts + COUNTS_PER_THS_LSB - 1) / COUNTS_PER_THS_LSB;
+    return (uint8_t)constrain(ths, 1UL, 127UL);
+}
@@ -0,0 +1,59 @@
+// AmbientFloor Class
+// Author: Chip McClelland
+// Date: October 2024
+// License: GPL3
+// In this class, we track the background vibration seen by the accelerometer on each axis so the tap thresholds can sit
+// a fixed margin above the site's noise floor (HVAC units, elevators, ...) instead of a fixed sensitivity setting.
+// Integer only - the mean and the mean absolute deviation are exponentially weighted averages kept in Q4 fixed point.
+
+#ifndef __AMBIENTFLOOR_H
+#define __AMBIENTFLOOR_H
+
+#include <arduino.h>
+#include "Config.h"
+
+#define AMBIENT_AXES 3                                      // x, y and z
+
+class AmbientFloor {
+public:
+    AmbientFloor();
+
+    /**
+     * @brief Forget everything learned so far
+     */
+    void reset();
+
+    /**
+     * @brief Add one quiet-period sample - raw 12-bit counts from MMA8452Q::read()
+     */
+    void addSample(int16_t x, int16_t y, int16_t z);
+
+    /**
+     * @brief True once enough samples have been seen for the floor to be trusted
+     */
+    bool isReady() const { return samples >= AMBIENT_MIN_SAMPLES; }
+
+    /**
+     * @brief Number of samples seen since the last reset (saturates)
+     */
+    uint16_t sampleCount() const { return samples; }
+
+    /**
+     * @brief Noise floor for an axis in raw counts (mean absolute deviation from the running mean)
+     */
+    uint16_t floorCounts(uint8_t axis) const;
+
+    /**
+     * @brief PULSE_THSx register value (1-127, 0.063g per LSB) that sits the configured margin above the floor
+     */
+    uint8_t threshold(uint8_t axis) const;
+
+private:
+    void addAxis(uint8_t axis, int16_t value);
+
+    int32_t meanQ4[AMBIENT_AXES];                           // Running mean in 1/16 counts
+    int32_t devQ4[AMBIENT_AXES];                            // Running mean absolute deviation in 1/16 counts
+    uint16_t samples;
+};
+
+#endif  /* __AMBIENTFLOOR_H */
@@ -7,6 +7,7 @@
 // Note, this code assumes that Zone 1 is the inner (relative to room we are measureing occupancy for) and Zone 2 is outer
 
 #include "Presence.h"
+#include "dailyArchive.h"
 
 Presence *Presence::_instance;
 
@@ -26,6 +27,11 @@ Presence::~Presence() {
 
 bool Presence::setup() {
 
+    PresenceFusion &fusion = PresenceFusion::instance();
+    fusion.setup();
+    fusion.setDetector(DETECTOR_ACCEL, true);                   // The accelerometer is always on
+    Log.infoln("Presence fusion rule %d with a %d second window (k=%d)", fusion.getRule(), fusion.getWindowSec(), fusion.getK());
+
     if (!TapSensor::instance().setup()) {
         return false;
     }
@@ -35,32 +41,142 @@ bool Presence::setup() {
 }
 
 bool Presence::loop() {
-    static bool lastOccupancyState = false;
-    static time_t occupancyPeriodStart = 0;
-    bool occupancyState = TapSensor::instance().loop();
+    bool tapDetected = TapSensor::instance().loop();
     time_t now = timeFunctions.getTime();
-    if (occupancyState) {                                       // Occupancy detected
-        if (!lastOccupancyState) {                              // This is a new occupancy period
-            lastOccupancyState = true;                          // Set the last state to true  
-            occupancyPeriodStart = timeFunctions.getTime();		// Begin a new period of occupancy  
-            Log.infoln("Starting a new occupancy period at %d", occupancyPeriodStart);
-            LED.on();                                           // Turn on the indicator LED - take out for production
-        }
-        else {
-            Log.infoln("Continue current occupancy period");
-        }
+
+    uint16_t events = (tapDetected) ? 1 : 0;
+    events += TapSensor::instance().takeBurstTail();            // A burst the holdoff coalesced still counts every tap
+    if (events) PresenceFusion::instance().reportEvent(DETECTOR_ACCEL, now);
+    if (detectionReported) events++;
+    update(events, now);
+
+    if (tapDetected) presenceLatency.endCycle();               // This interrupt has been handled
+
+    return true;
+}
+
+void Presence::endBurst() {
+    TapSensor::instance().endBurst();
+    uint16_t tail = TapSensor::instance().takeBurstTail();
+    if (!tail) return;
+    time_t now = timeFunctions.getTime();
+    PresenceFusion::instance().reportEvent(DETECTOR_ACCEL, now);
+    update(tail, now);                                          // Before we sleep - the enter window may be over when we wake
+}
+
+void Presence::update(uint16_t events, time_t now) {
+    bool occupancyEvent = false;                                // New evidence that the fusion rule accepts
+    if (events) {
+        detectionReported = false;
+        occupancyEvent = PresenceFusion::instance().evaluate(now);
+        Log.infoln("Presence evidence (%d events) - fused result %s with %d%% confidence", events, (occupancyEvent) ? "occupied" : "not occupied", getConfidence());
     }
-    else if (lastOccupancyState && ((now - occupancyPeriodStart) > sysStatus.debounceMin * 60UL)) {                                                   // Occupancy is no longer detected
-        lastOccupancyState = false;                            // End the period of occupancy
-        current.occupancyNet += timeFunctions.getTime() - occupancyPeriodStart;          // calculate the net occupancy time
-        current.occupancyGross = current.occupancyNet +1 ;     // Gross occupancy is bigger by one for testing memory storage
-        currentData.currentDataChanged = true;                 // Set the flag to save the data
-        Log.infoln("Occupancy period has ended - total occupancy today is currently %d seconds", current.occupancyNet);
-        LED.off();                                              // Turn off the LED now that occupancy is over
+    uint8_t added = (events < 255) ? events : 255;
+    bool exitDue = timeFunctions.eventFired(eventFlag_debounceEnd);   // The alarm onOccupancyStart() set to close the period
+
+    switch (state) {
+        case PRESENCE_VACANT:
+            if (occupancyEvent) {                                   // First events - may need more before we call it occupancy
+                pendingStart = now;
+                pendingCount = added;
+                lastEventTime = now;
+                transitionTo((pendingCount >= enterEvents) ? PRESENCE_OCCUPIED : PRESENCE_PENDING, now);
+            }
+        break;
+
+        case PRESENCE_PENDING:
+            if (now - pendingStart > (time_t)enterWindowSec) {      // Enter window expired - a single bump is not occupancy
+                if (occupancyEvent) {                               // ... but these events may start a new window
+                    pendingStart = now;
+                    pendingCount = added;
+                    lastEventTime = now;
+                    if (pendingCount >= enterEvents) transitionTo(PRESENCE_OCCUPIED, now);
+                }
+                else transitionTo(PRESENCE_VACANT, now);
+            }
+            else if (occupancyEvent) {
+                pendingCount = (pendingCount < 255 - added) ? pendingCount + added : 255;
+                lastEventTime = now;
+                if (pendingCount >= enterEvents) transitionTo(PRESENCE_OCCUPIED, now);
+            }
+        break;
+
+        case PRESENCE_OCCUPIED:
+            if (occupancyEvent) {
+                lastEventTime = now;                                // Each event pushes out the exit
+                timeFunctions.scheduleEvent(eventFlag_debounceEnd, lastEventTime + sysStatus.debounceMin * 60UL + 1);
+                Log.infoln("Continue current occupancy period");
+            }
+            else if (exitDue || now - lastEventTime > (time_t)(sysStatus.debounceMin * 60UL)) {   // No events for the exit period
+                transitionTo(PRESENCE_VACANT, now);
+            }
+        break;
     }
-    else {
-       // Log.infoln("No occupancy detected"); // This will run every loop if no occupancy is detected
+}
+
+void Presence::reportDetection(uint8_t detector) {
+    if (PresenceFusion::instance().reportEvent(detector, timeFunctions.getTime())) detectionReported = true;
+}
+
+void Presence::setEnterCriteria(uint8_t events, uint16_t windowSec) {
+    enterEvents = (events > 0) ? events : 1;
+    enterWindowSec = windowSec;
+}
+
+void Presence::setTransitionHook(void (*hook)(uint8_t from, uint8_t to)) {
+    transitionHook = hook;
+}
+
+const char *Presence::stateName(uint8_t presenceState) {
+    static const char *names[] = {"Vacant", "Pending", "Occupied"};
+    return (presenceState <= PRESENCE_OCCUPIED) ? names[presenceState] : "Unknown";
+}
+
+void Presence::transitionTo(uint8_t newState, time_t now) {
+    uint8_t oldState = state;
+    if (newState == oldState) return;
+    state = newState;
+
+    if (newState == PRESENCE_OCCUPIED) onOccupancyStart(now);
+    else if (oldState == PRESENCE_OCCUPIED) onOccupancyEnd(now);
+
+    if (transitionHook) transitionHook(oldState, newState);
+}
+
+void Presence::onOccupancyStart(time_t now) {
+    occupancyPeriodStart = pendingStart;                        // Occupancy began with the first event of the enter window
+    timeFunctions.scheduleEvent(eventFlag_debounceEnd, lastEventTime + sysStatus.debounceMin * 60UL + 1);   // Wake to close the period
+    presenceLatency.mark(LATENCY_STAGE_STATE);
+    Log.infoln("Starting a new occupancy period at %d (%d%% confidence)", occupancyPeriodStart, getConfidence());
+    LED.on();                                                   // Turn on the indicator LED - take out for production
+}
+
+void Presence::getContext(presenceContext &context) const {
+    context.state = state;
+    context.pendingCount = pendingCount;
+    context.pendingStart = pendingStart;
+    context.lastEventTime = lastEventTime;
+    context.occupancyPeriodStart = occupancyPeriodStart;
+}
+
+void Presence::setContext(const presenceContext &context) {
+    state = (context.state <= PRESENCE_OCCUPIED) ? context.state : PRESENCE_VACANT;
+    pendingCount = context.pendingCount;
+    pendingStart = context.pendingStart;
+    lastEventTime = context.lastEventTime;
+    occupancyPeriodStart = context.occupancyPeriodStart;
+    if (state == PRESENCE_OCCUPIED) {
+        LED.on();
+        timeFunctions.scheduleEvent(eventFlag_debounceEnd, lastEventTime + sysStatus.debounceMin * 60UL + 1);
     }
+    Log.infoln("Presence resumed in the %s state", stateName(state));
+}
 
-    return true;
+void Presence::onOccupancyEnd(time_t now) {
+    timeFunctions.cancelEvent(eventFlag_debounceEnd);
+    currentData.set_occupancyNet(current.occupancyNet + (now - occupancyPeriodStart));   // calculate the net occupancy time - the setter flags the save
+    currentData.set_occupancyGross(current.occupancyNet +1);    // Gross occupancy is bigger by one for testing memory storage
+    archive.recordSession(occupancyPeriodStart, now);           // Session count and peak hour for the daily archive
+    Log.infoln("Occupancy period has ended - total occupancy today is currently %d seconds", current.occupancyNet);
+    LED.off();                                                  // Turn off the LED now that occupancy is over
 }
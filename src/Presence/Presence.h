@@ -15,8 +15,15 @@
 #include "ErrorCodes.h"
 #include "stsLED.h"
 #include "TapSensor.h"
+#include "PresenceFusion.h"
+#include "PresenceLatency.h"
 #include "timing.h"
 
+// Presence states - occupancy needs PRESENCE_ENTER_EVENTS events within PRESENCE_ENTER_WINDOW_SEC to start
+// and ends when there have been no events for sysStatus.debounceMin minutes
+#define PRESENCE_VACANT 0
+#define PRESENCE_PENDING 1
+#define PRESENCE_OCCUPIED 2
 
 /**
  * This class is a singleton; you do not create one as a global, on the stack, or with new.
@@ -50,6 +57,66 @@ public:
      */
     bool loop();
 
+    /**
+     * @brief Ends the tap sensor's burst holdoff and counts the burst - call before sleeping
+     */
+    void endBurst();
+
+    /**
+     * @brief Returns the current presence state - PRESENCE_VACANT, PRESENCE_PENDING or PRESENCE_OCCUPIED
+     */
+    uint8_t getState() const { return state; }
+
+    /**
+     * @brief Confidence (0-100) of the fused detector evidence when it was last evaluated
+     */
+    uint8_t getConfidence() const { return PresenceFusion::instance().getConfidence(); }
+
+    /**
+     * @brief Reports an event from a detector other than the tap sensor (e.g. DETECTOR_PIR) - fused on the next loop()
+     *
+     * The detector must have been enabled with PresenceFusion::instance().setDetector()
+     */
+    void reportDetection(uint8_t detector);
+
+    /**
+     * @brief Returns a readable name for a presence state
+     */
+    static const char *stateName(uint8_t presenceState);
+
+    /**
+     * @brief Sets the enter criteria - this many events within windowSec seconds start an occupancy period
+     */
+    void setEnterCriteria(uint8_t events, uint16_t windowSec);
+
+    /**
+     * @brief Register a function to be called on every presence state change
+     *
+     * @details The hook is called after the state has changed and the occupancy totals are updated
+     */
+    void setTransitionHook(void (*hook)(uint8_t from, uint8_t to));
+
+    /**
+     * @brief The state machine's working state - saved across an AB1805 deepPowerDown() by rtcSnapshot
+     */
+    struct presenceContext {
+        uint8_t state;
+        uint8_t pendingCount;
+        time_t pendingStart;
+        time_t lastEventTime;
+        time_t occupancyPeriodStart;
+    };
+
+    /**
+     * @brief Copy out the state machine's working state
+     */
+    void getContext(presenceContext &context) const;
+
+    /**
+     * @brief Pick up where a saved context left off - re-schedules the debounce wake if occupied
+     */
+    void setContext(const presenceContext &context);
+
 protected:
     /**
      * @brief The constructor is protected because the class is a singleton
@@ -80,7 +147,39 @@ protected:
      */
     static Presence *_instance;
 
+    /**
+     * @brief Moves the state machine to a new state and runs the enter / exit actions
+     */
+    /**
+     * @brief Fuses any new evidence and runs the enter and exit state machine
+     *
+     * @param events - detector events since the last call, each tap of a burst counting as one
+     */
+    void update(uint16_t events, time_t now);
+
+    void transitionTo(uint8_t newState, time_t now);
+
+    /**
+     * @brief Called when a new occupancy period starts
+     */
+    void onOccupancyStart(time_t now);
+
+    /**
+     * @brief Called when an occupancy period ends - accumulates the occupancy time and flags it to be saved
+     */
+    void onOccupancyEnd(time_t now);
+
     int count = 0;
 
+    uint8_t state = PRESENCE_VACANT;
+    uint8_t enterEvents = PRESENCE_ENTER_EVENTS;            // Events needed to start an occupancy period
+    uint16_t enterWindowSec = PRESENCE_ENTER_WINDOW_SEC;    // ... within this many seconds of the first one
+    uint8_t pendingCount = 0;                               // Events seen in the current enter window
+    time_t pendingStart = 0;                                // Time of the first event in the enter window
+    time_t lastEventTime = 0;                               // Time of the most recent event - exit is measured from here
+    time_t occupancyPeriodStart = 0;                        // Start of the current occupancy period
+    bool detectionReported = false;                         // reportDetection() has new evidence for the next loop()
+    void (*transitionHook)(uint8_t from, uint8_t to) = nullptr;
+
 };
 #endif  /* __Presence_H */
@@ -0,0 +1,103 @@
+// PresenceFusion Class
+// Author: Chip McClelland
+// Date: October 2024
+// License: GPL3
+// In this class, we fuse the events from the available detectors into one occupancy state and a confidence value
+
+#include "PresenceFusion.h"
+
+PresenceFusion *PresenceFusion::_instance;
+
+// [static]
+PresenceFusion &PresenceFusion::instance() {
+    if (!_instance) {
+        _instance = new PresenceFusion();
+    }
+    return *_instance;
+}
+
+PresenceFusion::PresenceFusion() {
+}
+
+PresenceFusion::~PresenceFusion() {
+}
+
+bool PresenceFusion::setup() {
+    for (uint8_t i = 0; i < FUSION_MAX_DETECTORS; i++) {
+        detectors[i].enabled = false;
+        detectors[i].weight = 100;
+        detectors[i].lastEvent = 0;
+    }
+    setRule(FUSION_DEFAULT_RULE, FUSION_DEFAULT_WINDOW_SEC, FUSION_DEFAULT_K);
+    occupied = false;
+    confidence = 0;
+    return true;
+}
+
+bool PresenceFusion::reportEvent(uint8_t detector, time_t timestamp) {
+    if (detector >= FUSION_MAX_DETECTORS || !detectors[detector].enabled) return false;
+    if (timestamp > detectors[detector].lastEvent) detectors[detector].lastEvent = timestamp;
+    return true;
+}
+
+void PresenceFusion::setRule(uint8_t newRule, uint16_t newWindowSec, uint8_t k) {
+    rule = (newRule <= FUSION_RULE_WEIGHTED) ? newRule : FUSION_RULE_ANY_OF;
+    windowSec = (newWindowSec > 0) ? newWindowSec : 1;
+    kRequired = (k > 0) ? k : 1;
+}
+
+void PresenceFusion::setDetector(uint8_t detector, bool enabled, uint8_t weight) {
+    if (detector >= FUSION_MAX_DETECTORS) return;
+    detectors[detector].enabled = enabled;
+    detectors[detector].weight = (weight < 100) ? weight : 100;
+    if (!enabled) detectors[detector].lastEvent = 0;
+}
+
+uint8_t PresenceFusion::freshness(uint8_t detector, time_t now) const {
+    time_t lastEvent = detectors[detector].lastEvent;
+    if (!detectors[detector].enabled || lastEvent == 0) return 0;
+    if (lastEvent >= now) return 100;
+    uint32_t age = now - lastEvent;
+    if (age >= windowSec) return 0;
+    return (uint8_t)(100UL - (age * 100UL) / windowSec);
+}
+
+bool PresenceFusion::evaluate(time_t now) {
+    uint8_t fresh = 0;                                      // Detectors with an event inside the window
+    uint8_t enabled = 0;
+    uint8_t strongest = 0;                                  // Freshest evidence from any one detector
+    uint32_t evidence = 0;                                  // Sum of weight * freshness
+    uint32_t totalWeight = 0;
+
+    for (uint8_t i = 0; i < FUSION_MAX_DETECTORS; i++) {
+        if (!detectors[i].enabled) continue;
+        enabled++;
+        totalWeight += detectors[i].weight;
+        uint8_t f = freshness(i, now);
+        if (f == 0) continue;
+        fresh++;
+        if (f > strongest) strongest = f;
+        evidence += (uint32_t)detectors[i].weight * f;
+    }
+
+    switch (rule) {
+        case FUSION_RULE_K_OF_N: {
+            uint8_t k = (kRequired < enabled) ? kRequired : enabled;
+            occupied = (k > 0 && fresh >= k);
+            confidence = (k > 0 && fresh < k) ? (uint8_t)((fresh * 100) / k) : (k > 0) ? 100 : 0;
+        } break;
+
+        case FUSION_RULE_WEIGHTED:
+            confidence = (totalWeight > 0) ? (uint8_t)(evidence / totalWeight) : 0;     // A weighted mean of freshness - never above 100
+            occupied = (confidence >= weightThreshold);
+        break;
+
+        case FUSION_RULE_ANY_OF:
+        default:
+            occupied = (fresh > 0);
+            confidence = strongest;
+        break;
+    }
+
+    return occupied;
+}
@@ -0,0 +1,161 @@
+// PresenceFusion Class
+// Author: Chip McClelland
+// Date: October 2024
+// License: GPL3
+// In this class, we combine timestamped events from several detector backends (accelerometer, PIR, ...) into a single
+// occupancy state with a confidence value.  A cheap always-on detector can then be paired with a confirmatory one that
+// is only powered up when the cheap one has seen something.
+// Kept free of Arduino so the rules can be unit tested on the host (pio test -e native) - Presence logs the result.
+
+#ifndef __PRESENCEFUSION_H
+#define __PRESENCEFUSION_H
+
+#include <stdint.h>
+#include <time.h>                                           // time_t
+#include "Config.h"
+
+// Detector backends that can report events to the fusion engine
+#define DETECTOR_ACCEL 0                                    // MMA8452Q tap sensor
+#define DETECTOR_PIR 1                                      // PIR sensor (sysStatus.sensorType)
+#define FUSION_MAX_DETECTORS 4
+
+// Rules for combining the detector evidence
+#define FUSION_RULE_ANY_OF 0                                // Occupied if any enabled detector fired within the window
+#define FUSION_RULE_K_OF_N 1                                // Occupied if at least k of the enabled detectors fired within the window
+#define FUSION_RULE_WEIGHTED 2                              // Occupied if the weighted, time-decayed evidence reaches the threshold
+
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * From global application setup you must call:
+ * PresenceFusion::instance().setup();
+ *
+ * Each detector backend reports its events with reportEvent() and the result is read back with evaluate()
+ */
+class PresenceFusion {
+public:
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use PresenceFusion::instance() to instantiate the singleton.
+     */
+    static PresenceFusion &instance();
+
+    /**
+     * @brief Perform setup operations - loads the default rule from Config.h and clears all evidence
+     *
+     * You typically use PresenceFusion::instance().setup();
+     */
+    bool setup();
+
+    /**
+     * @brief Record an event from one of the detector backends
+     *
+     * @param detector - DETECTOR_ACCEL, DETECTOR_PIR, ...
+     * @param timestamp - time of the event (RTC seconds - millis() does not advance while asleep)
+     * @returns false if the detector is not enabled - the event is ignored
+     */
+    bool reportEvent(uint8_t detector, time_t timestamp);
+
+    /**
+     * @brief Combine the evidence according to the current rule
+     *
+     * @param now - current time in RTC seconds
+     * @returns true if the fused result is "occupied" - confidence is updated as a side effect
+     */
+    bool evaluate(time_t now);
+
+    /**
+     * @brief Result of the last evaluate() call
+     */
+    bool isOccupied() const { return occupied; }
+
+    /**
+     * @brief Confidence of the last evaluate() call from 0 (no evidence) to 100 (certain)
+     */
+    uint8_t getConfidence() const { return confidence; }
+
+    /**
+     * @brief True if there is some evidence but not enough to declare occupancy
+     *
+     * @details This is the signal to power up a confirmatory (more expensive) detector
+     */
+    bool confirmationNeeded() const { return !occupied && confidence > 0; }
+
+    /**
+     * @brief Select the fusion rule
+     *
+     * @param rule - FUSION_RULE_ANY_OF, FUSION_RULE_K_OF_N or FUSION_RULE_WEIGHTED
+     * @param windowSec - how long an event counts as evidence
+     * @param k - number of detectors required for FUSION_RULE_K_OF_N
+     */
+    void setRule(uint8_t rule, uint16_t windowSec, uint8_t k = FUSION_DEFAULT_K);
+
+    uint8_t getRule() const { return rule; }
+
+    uint16_t getWindowSec() const { return windowSec; }
+
+    uint8_t getK() const { return kRequired; }
+
+    /**
+     * @brief Enable or disable a detector and set its weight (0-100) for FUSION_RULE_WEIGHTED
+     */
+    void setDetector(uint8_t detector, bool enabled, uint8_t weight = 100);
+
+    /**
+     * @brief Confidence (0-100) that must be reached for FUSION_RULE_WEIGHTED to declare occupancy
+     */
+    void setThreshold(uint8_t threshold) { weightThreshold = (threshold < 1) ? 1 : (threshold > 100) ? 100 : threshold; }
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use PresenceFusion::instance() to instantiate the singleton.
+     */
+    PresenceFusion();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~PresenceFusion();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    PresenceFusion(const PresenceFusion&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    PresenceFusion& operator=(const PresenceFusion&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static PresenceFusion *_instance;
+
+    /**
+     * @brief Evidence (0-100) left from a detector's last event - decays linearly to 0 over the window
+     */
+    uint8_t freshness(uint8_t detector, time_t now) const;
+
+    struct Detector {
+        bool enabled;                                       // Only enabled detectors count towards "n"
+        uint8_t weight;                                     // Weight for FUSION_RULE_WEIGHTED (0-100)
+        time_t lastEvent;                                   // Time of the most recent event (0 = none)
+    };
+    Detector detectors[FUSION_MAX_DETECTORS];
+
+    uint8_t rule = FUSION_DEFAULT_RULE;
+    uint16_t windowSec = FUSION_DEFAULT_WINDOW_SEC;
+    uint8_t kRequired = FUSION_DEFAULT_K;
+    uint8_t weightThreshold = FUSION_DEFAULT_WEIGHT_THRESHOLD;
+
+    bool occupied = false;
+    uint8_t confidence = 0;
+};
+#endif  /* __PRESENCEFUSION_H */
@@ -0,0 +1,36 @@
+// PresenceLatency Class
+// Author: Chip McClelland
+// Date: October 2024
+// License: GPL3
+// In this class, we keep the interrupt-to-detection latency counters for the presence path
+
+#include "PresenceLatency.h"
+
+static const char *stageNames[LATENCY_STAGES] = {"ISR to wake", "ISR to serial", "ISR to tap decode", "ISR to state change"};
+
+PresenceLatency *PresenceLatency::_instance;
+
+// [static]
+PresenceLatency &PresenceLatency::instance() {
+    if (!_instance) {
+        _instance = new PresenceLatency();
+    }
+    return *_instance;
+}
+
+PresenceLatency::PresenceLatency() {
+    reset();
+}
+
+PresenceLatency::~PresenceLatency() {
+}
+
+void PresenceLatency::reset() {
+    for (uint8_t i = 0; i < LATENCY_STAGES; i++) stats[i].reset();
+    pending = false;
+}
+
+void PresenceLatency::print() {
+    Log.infoln("Presence latency (from sensor interrupt)");
+    for (uint8_t i = 0; i < LATENCY_STAGES; i++) stats[i].print(stageNames[i]);
+}
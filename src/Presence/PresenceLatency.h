@@ -0,0 +1,109 @@
+// PresenceLatency Class
+// Author: Chip McClelland
+// Date: October 2024
+// License: GPL3
+// In this class, we timestamp the presence path from the accelerometer raising I2C_INT to Presence::loop() acting on it
+// ISR entry -> LowPower.sleep() returns -> Serial re-opened -> tap decoded -> occupancy state change
+
+#ifndef __PRESENCELATENCY_H
+#define __PRESENCELATENCY_H
+
+#include <arduino.h>
+#include <ArduinoLog.h>
+#include "Config.h"
+#include "latencyStats.h"
+
+// Stages measured from the sensor interrupt
+#define LATENCY_STAGE_WAKE 0                                // LowPower.sleep() has returned
+#define LATENCY_STAGE_SERIAL 1                              // Serial port re-opened (or timed out) after wake
+#define LATENCY_STAGE_DECODE 2                              // TapSensor::loop() has read and cleared the tap
+#define LATENCY_STAGE_STATE 3                               // Presence::loop() started a new occupancy period
+#define LATENCY_STAGES 4
+
+#define presenceLatency PresenceLatency::instance()
+
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * Call markInterrupt() from the sensor ISR, mark() as each stage completes and endCycle() once the
+ * event has been handled.  print() dumps the counters over serial.
+ */
+class PresenceLatency {
+public:
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use PresenceLatency::instance() to instantiate the singleton.
+     */
+    static PresenceLatency &instance();
+
+    /**
+     * @brief Clears all of the counters
+     */
+    void reset();
+
+    /**
+     * @brief Capture the start of a cycle - safe to call from an ISR
+     */
+    inline void markInterrupt() {
+        if (!PRESENCE_LATENCY_TRACE) return;
+        isrMicros = micros();
+        pending = true;
+    }
+
+    /**
+     * @brief Record the time from the interrupt to this stage (ignored if no interrupt is pending)
+     *
+     * @param stage - LATENCY_STAGE_WAKE, LATENCY_STAGE_SERIAL, LATENCY_STAGE_DECODE or LATENCY_STAGE_STATE
+     */
+    inline void mark(uint8_t stage) {
+        if (!PRESENCE_LATENCY_TRACE || !pending || stage >= LATENCY_STAGES) return;
+        stats[stage].record(micros() - isrMicros);
+    }
+
+    /**
+     * @brief The interrupt has been fully handled - later stages are not attributed to it
+     */
+    inline void endCycle() { pending = false; }
+
+    /**
+     * @brief Dump min / avg / max and the histogram for each stage to the log
+     */
+    void print();
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use PresenceLatency::instance() to instantiate the singleton.
+     */
+    PresenceLatency();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~PresenceLatency();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    PresenceLatency(const PresenceLatency&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    PresenceLatency& operator=(const PresenceLatency&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static PresenceLatency *_instance;
+
+    volatile uint32_t isrMicros = 0;                        // micros() at ISR entry
+    volatile bool pending = false;                          // An interrupt has been seen and not yet handled
+    latencyStats stats[LATENCY_STAGES];
+};
+#endif  /* __PRESENCELATENCY_H */
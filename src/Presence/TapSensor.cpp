@@ -7,6 +7,7 @@
 // Note, this code assumes that Zone 1 is the inner (relative to room we are measureing occupancy for) and Zone 2 is outer
 
 #include "TapSensor.h"
+#include "PresenceLatency.h"
 
 // Create an MMA8452Q object, used throughout the rest of the sketch.
 MMA8452Q accel; // Default constructor, SA0 pin is HIGH
@@ -43,7 +44,7 @@ bool TapSensor::setup() {
         return false;
     }
 
-    sysStatus.sensitivity = 1;
+    sysData.set_sensitivity(1);
 
     accel.setupTapIntsLatch(sysStatus.sensitivity);                        // Set up the tap interrupt
 
@@ -73,12 +74,64 @@ bool TapSensor::loop() {                                            // Called by
     }
     */
 
+    if (inHoldoff) {                                                // Interrupt is masked - count the rest of the burst from PULSE_SRC
+        if (millis() - lastPoll >= TAP_SENSOR_HOLDOFF_POLL_MS) {
+            lastPoll = millis();
+            if (accel.readTap()) suppressedTaps++;                  // Reading PULSE_SRC also clears the latch
+        }
+        if (millis() - holdoffStart >= holdoffMs) endHoldoff();
+        return false;                                               // The burst was reported on its first tap
+    }
+
     if (digitalRead(gpio.I2C_INT)) {                                // All we are doing here is passing back the occupancy to the presence function
         // Log.infoln("Occupancy detected");
         TapSensor::clearTapInts();                                  // Clear the interrupt
+        lastTapMillis = millis();
+        presenceLatency.mark(LATENCY_STAGE_DECODE);
+        if (holdoffMs) startHoldoff();                              // Coalesce the rest of the burst into one wake
         return true;
     }
     else {
+        if (AMBIENT_AUTO_THRESHOLD) trackAmbientFloor();
         return false;
     }
 }
+
+void TapSensor::trackAmbientFloor() {
+    if (millis() - lastTapMillis < AMBIENT_QUIET_MS) return;        // Only learn from quiet periods - taps are not noise
+    if (millis() - lastAmbientSample < AMBIENT_SAMPLE_MS) return;
+    lastAmbientSample = millis();
+
+    accel.read();
+    ambient.addSample(accel.x, accel.y, accel.z);
+    if (!ambient.isReady() || ++samplesSinceUpdate < AMBIENT_UPDATE_SAMPLES) return;
+    samplesSinceUpdate = 0;
+
+    uint8_t x = ambient.threshold(0), y = ambient.threshold(1), z = ambient.threshold(2);
+    if (x == thresholds[0] && y == thresholds[1] && z == thresholds[2]) return;   // No register writes unless something moved
+    Log.infoln("Noise floor (%d,%d,%d) counts - tap thresholds now (%d,%d,%d)", ambient.floorCounts(0), ambient.floorCounts(1), ambient.floorCounts(2), x, y, z);
+    applyThresholds(x, y, z);
+}
+
+void TapSensor::applyThresholds(uint8_t xThs, uint8_t yThs, uint8_t zThs) {
+    accel.setTapThresholds(xThs, yThs, zThs);
+    thresholds[0] = xThs;
+    thresholds[1] = yThs;
+    thresholds[2] = zThs;
+}
+
+void TapSensor::startHoldoff() {
+    accel.disableTapInts();
+    inHoldoff = true;
+    holdoffStart = millis();
+    lastPoll = holdoffStart;
+    suppressedTaps = 0;
+}
+
+void TapSensor::endHoldoff() {
+    if (accel.readTap()) suppressedTaps++;                          // Anything latched since the last poll
+    accel.enableTapInts();
+    inHoldoff = false;
+    burstTail += suppressedTaps;
+    if (suppressedTaps) Log.infoln("Tap burst of %d taps coalesced into one wake", 1 + suppressedTaps);
+}
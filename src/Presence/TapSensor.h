@@ -5,7 +5,7 @@
 // In this class, we are using a sensor to determine whether a space is occupied or not (binary)
 
 #ifndef __TAPSENSOR_H
-#define __TAPSENOSR_H
+#define __TAPSENSOR_H
 
 #include <arduino.h>
 #include <ArduinoLog.h>
@@ -15,6 +15,7 @@
 #include "ErrorCodes.h"
 #include "stsLED.h"
 #include "ModMMA8452Q.h"
+#include "AmbientFloor.h"
 
 
 /**
@@ -54,6 +55,32 @@ public:
     */
     void clearTapInts();
 
+    /**
+     * @brief Sets the burst holdoff - after a tap the interrupt is masked for this many ms (0 disables coalescing)
+     */
+    void setHoldoff(uint32_t ms) { holdoffMs = ms; }
+
+    /**
+     * @brief Ends a holdoff early - call before sleeping so the tap interrupt is armed without a timed wake
+     */
+    void endBurst() { if (inHoldoff) endHoldoff(); }
+
+    /**
+     * @brief Taps the holdoff masked in bursts that have ended since the last call - the first tap of each burst was
+     * already reported by loop()
+     */
+    uint16_t takeBurstTail() { uint16_t taps = burstTail; burstTail = 0; return taps; }
+
+    /**
+     * @brief Applies per-axis tap thresholds (1-127, 0.063g per LSB) and remembers them
+     */
+    void applyThresholds(uint8_t xThs, uint8_t yThs, uint8_t zThs);
+
+    /**
+     * @brief The tap threshold currently programmed for an axis (0 = x, 1 = y, 2 = z), 0 if set from sensitivity
+     */
+    uint8_t getThreshold(uint8_t axis) const { return (axis < AMBIENT_AXES) ? thresholds[axis] : 0; }
+
 protected:
     /**
      * @brief The constructor is protected because the class is a singleton
@@ -84,7 +111,35 @@ protected:
      */
     static TapSensor *_instance;
 
+    /**
+     * @brief Masks the tap interrupt and starts counting the taps in the burst
+     */
+    void startHoldoff();
+
+    /**
+     * @brief Collects the last latched tap, re-arms the interrupt and adds the suppressed taps to the burst tail
+     */
+    void endHoldoff();
+
+    /**
+     * @brief Samples the accelerometer during quiet periods and moves the thresholds with the noise floor
+     */
+    void trackAmbientFloor();
+
     int count = 0;
 
+    uint32_t holdoffMs = TAP_SENSOR_HOLDOFF_MS;             // How long the interrupt is masked after a tap
+    bool inHoldoff = false;
+    unsigned long holdoffStart = 0;                         // millis() when the holdoff began
+    unsigned long lastPoll = 0;                             // millis() of the last PULSE_SRC poll during holdoff
+    uint16_t suppressedTaps = 0;                            // Taps latched while the interrupt was masked
+    uint16_t burstTail = 0;                                 // Suppressed taps not yet collected with takeBurstTail()
+
+    AmbientFloor ambient;                                   // Background vibration estimate
+    unsigned long lastTapMillis = 0;                        // millis() of the last tap - sampling waits for quiet
+    unsigned long lastAmbientSample = 0;
+    uint16_t samplesSinceUpdate = 0;
+    uint8_t thresholds[AMBIENT_AXES] = {0, 0, 0};           // Thresholds currently programmed (0 = from sensitivity)
+
 };
 #endif  /* __TapSensor_H */
@@ -0,0 +1,154 @@
+/**
+ * @file    archiveRing.h
+ * @author  Chip McClelland (chip@seeinsights.com)
+ * @brief   Layout of the daily archive image and the rules for adding a day - see dailyArchive.h
+ * @details Kept free of Arduino so the write order can be unit tested on the host (pio test -e native).
+ *
+ * The header's CRC covers the header and only the records it says are held, and a new day only ever goes into a
+ * slot the committed header does not hold.  Until the header page is written the old header still checks out,
+ * so a write torn anywhere in the data area, or a header write that fails, leaves the archive as it was.
+ *
+ * @version 0.1
+ * @date    2024-10-20
+ *
+ */
+
+#ifndef __ARCHIVERING_H
+#define __ARCHIVERING_H
+
+#include <stdint.h>
+#include <string.h>
+#include "crc16.h"
+
+#define ARCHIVE_MAGIC 0xDC                              // 0xDB's CRC covered the whole ring, 0xDA was the variable length coding
+#define ARCHIVE_HEADER_SIZE 8
+#define ARCHIVE_RECORD_SIZE 3
+#define ARCHIVE_SLOTS 32
+#define ARCHIVE_DATA_SIZE (ARCHIVE_SLOTS * ARCHIVE_RECORD_SIZE)
+#define ARCHIVE_IMAGE_SIZE (ARCHIVE_HEADER_SIZE + ARCHIVE_DATA_SIZE)
+#define ARCHIVE_MAX_DAYS (ARCHIVE_SLOTS - 1)            // One slot is always free, so a full archive can take a day without touching the ones it holds
+#define ARCHIVE_NO_PEAK 24                              // Peak hour of a day without occupancy
+#define ARCHIVE_GAP 31                                  // Peak hour value of a day that was not recorded
+
+namespace ArchiveRing {
+
+    struct daySummary {
+        uint16_t day;                                   // Days since 1970 (GMT)
+        uint32_t occupiedSec;
+        uint16_t sessions;
+        uint8_t peakHour;                               // 0-23 GMT, ARCHIVE_NO_PEAK if never occupied
+    };
+
+    inline uint8_t count(const uint8_t *img) {
+        return img[1];
+    }
+
+    inline uint16_t oldestDay(const uint8_t *img) {
+        return img[2] | (img[3] << 8);
+    }
+
+    /**
+     * @brief Offset of the record for the day index days after the oldest one
+     */
+    inline uint8_t recordOffset(const uint8_t *img, uint8_t index) {
+        return ARCHIVE_HEADER_SIZE + ((img[4] + index) % ARCHIVE_SLOTS) * ARCHIVE_RECORD_SIZE;
+    }
+
+    /**
+     * @brief CRC-16 over the header (with the CRC bytes taken as zero) and the records it holds, oldest first
+     */
+    inline uint16_t crc(const uint8_t *img) {
+        uint8_t header[ARCHIVE_HEADER_SIZE];
+        memcpy(header, img, sizeof(header));
+        header[5] = header[6] = 0;
+        uint16_t crc = crc16Ccitt(header, sizeof(header));
+        for (uint8_t i = 0; i < count(img); i++) crc = crc16Ccitt(&img[recordOffset(img, i)], ARCHIVE_RECORD_SIZE, crc);
+        return crc;
+    }
+
+    inline bool valid(const uint8_t *img) {
+        return img[0] == ARCHIVE_MAGIC && img[1] <= ARCHIVE_MAX_DAYS && img[4] < ARCHIVE_SLOTS && (img[5] | (img[6] << 8)) == crc(img);
+    }
+
+    /**
+     * @brief Sets the magic and CRC once the image is final
+     */
+    inline void seal(uint8_t *img) {
+        img[0] = ARCHIVE_MAGIC;
+        img[7] = 0;
+        uint16_t value = crc(img);
+        img[5] = value & 0xFF;
+        img[6] = value >> 8;
+    }
+
+    /**
+     * @brief Empties the archive - the next day added is the oldest
+     */
+    inline void reset(uint8_t *img, uint16_t day) {
+        img[1] = 0;
+        img[2] = day & 0xFF;
+        img[3] = day >> 8;
+        img[4] = 0;
+    }
+
+    inline void dropOldest(uint8_t *img, uint8_t days) {
+        if (days > img[1]) days = img[1];
+        uint16_t oldest = oldestDay(img) + days;
+        img[1] -= days;
+        img[2] = oldest & 0xFF;
+        img[3] = oldest >> 8;
+        img[4] = (img[4] + days) % ARCHIVE_SLOTS;
+    }
+
+    /**
+     * @brief Writes the record after the newest day held - the slot must be free
+     */
+    inline void append(uint8_t *img, const daySummary &summary) {
+        uint32_t minutes = (summary.occupiedSec + 30) / 60;
+        if (minutes > 1440) minutes = 1440;
+        uint32_t packed = (summary.peakHour & 0x1F) | (minutes << 5) | ((uint32_t)((summary.sessions < 255) ? summary.sessions : 255) << 16);
+        uint8_t pos = recordOffset(img, img[1]);
+        img[pos] = packed & 0xFF;
+        img[pos + 1] = (packed >> 8) & 0xFF;
+        img[pos + 2] = packed >> 16;
+        img[1]++;
+    }
+
+    inline void readDay(const uint8_t *img, uint8_t index, daySummary &summary) {
+        uint8_t pos = recordOffset(img, index);
+        uint32_t packed = img[pos] | ((uint32_t)img[pos + 1] << 8) | ((uint32_t)img[pos + 2] << 16);
+        summary.day = oldestDay(img) + index;
+        summary.peakHour = packed & 0x1F;
+        summary.occupiedSec = ((packed >> 5) & 0x7FF) * 60UL;
+        summary.sessions = packed >> 16;
+    }
+
+    /**
+     * @brief Works out the images that add a day after the newest one held, with any days in between marked ARCHIVE_GAP
+     *
+     * @param committed - what the EEPROM holds; summary.day must be later than its newest day
+     * @param staged - set to a header that lets go of the oldest days when the new records need their slots
+     * @param final - set to the image holding the new day
+     *
+     * @returns true if staged has to be committed (it only changes the header) before final is written
+     */
+    inline bool addDay(const uint8_t *committed, const daySummary &summary, uint8_t *staged, uint8_t *final) {
+        memcpy(staged, committed, ARCHIVE_IMAGE_SIZE);
+        uint8_t held = count(committed);
+        uint32_t adding = (held) ? (uint32_t)(summary.day - (oldestDay(committed) + held - 1)) : ARCHIVE_SLOTS;   // The gaps and the day itself
+        if (adding > ARCHIVE_MAX_DAYS) {                                    // Nothing held would survive the gap - start over
+            reset(staged, summary.day);
+            adding = 1;
+        }
+        else if (adding > (uint32_t)(ARCHIVE_SLOTS - held)) dropOldest(staged, adding - (ARCHIVE_SLOTS - held));
+
+        memcpy(final, staged, ARCHIVE_IMAGE_SIZE);
+        daySummary gap = {0, 0, 0, ARCHIVE_GAP};
+        for (uint32_t i = 1; i < adding; i++) append(final, gap);
+        append(final, summary);
+        if (count(final) > ARCHIVE_MAX_DAYS) dropOldest(final, count(final) - ARCHIVE_MAX_DAYS);
+        return count(staged) != held;
+    }
+}
+
+#endif /* __ARCHIVERING_H */
@@ -0,0 +1,22 @@
+#ifndef __CRC16_H
+#define __CRC16_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief CRC-16/CCITT-FALSE (rtcStore::crc16) - free of Arduino so it can be unit tested on the host
+ *
+ * @param crc - pass the CRC of the bytes before data to carry on a CRC over pieces that are not contiguous
+ */
+inline uint16_t crc16Ccitt(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+#endif /* __CRC16_H */
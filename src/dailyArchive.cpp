@@ -0,0 +1,142 @@
+#include "dailyArchive.h"
+
+dailyArchive *dailyArchive::_instance;
+
+static_assert(ARCHIVE_MAX_DAYS >= 30, "The archive must hold at least 30 days");
+static_assert(ARCHIVE_IMAGE_SIZE <= ARCHIVE_END - ARCHIVE_START, "The archive does not fit in the EEPROM");
+
+// [static]
+dailyArchive &dailyArchive::instance() {
+    if (!_instance) {
+        _instance = new dailyArchive();
+    }
+    return *_instance;
+}
+
+dailyArchive::dailyArchive() {
+    memset(image, 0, sizeof(image));
+}
+
+dailyArchive::~dailyArchive() {
+}
+
+bool dailyArchive::setup() {
+    eepromRead(ARCHIVE_START, image, sizeof(image));
+
+    if (ArchiveRing::valid(image)) Log.infoln("Daily archive holds %d days", count());
+    else {
+        uint8_t empty[sizeof(image)];
+        memcpy(empty, image, sizeof(empty));                            // Leave the data area alone - only the header is written
+        ArchiveRing::reset(empty, 0);
+        Log.infoln("No daily archive - starting one");
+        if (!write(empty)) return false;
+    }
+
+    dayStats stats;
+    if (!rtcMem.get(RTC_KEY_DAY_STATS, stats)) {                       // RTC RAM was lost - the tally starts now
+        startTally(timeFunctions.getTime() / 86400L);
+        return true;
+    }
+    return closeDay();                                                  // The day may have ended while the device was off
+}
+
+void dailyArchive::recordSession(time_t start, time_t end) {
+    if (end <= start) return;
+
+    closeDay();                                                         // A session ending after a missed rollover belongs to a new day
+    dayStats stats;
+    loadStats(stats);
+    stats.sessions++;
+    for (time_t t = start; t < end; ) {                                 // Split the session at hour boundaries
+        time_t sliceEnd = (t / 3600L + 1) * 3600L;
+        if (sliceEnd > end) sliceEnd = end;
+        addSeconds(stats, (t / 3600L) % 24, sliceEnd - t);
+        t = sliceEnd;
+    }
+    rtcMem.put(RTC_KEY_DAY_STATS, stats);
+}
+
+bool dailyArchive::closeDay() {
+    uint16_t today = timeFunctions.getTime() / 86400L;
+    dayStats stats;
+    loadStats(stats);
+    if (stats.day >= today) return true;                                // Still running
+
+    if (count() && stats.day < ArchiveRing::oldestDay(image) + count()) {   // Reset between the write and starting the next tally
+        Log.infoln("Day %u is already archived", stats.day);
+        startTally(today);
+        return true;
+    }
+
+    addSeconds(stats, 0xFF, 0);                                         // Settles the hour still being tallied
+    daySummary summary;
+    summary.day = stats.day;
+    summary.occupiedSec = stats.occupiedSec;
+    summary.sessions = stats.sessions;
+    summary.peakHour = (stats.peakSec) ? stats.peakHour : ARCHIVE_NO_PEAK;
+
+    uint8_t staged[sizeof(image)], final[sizeof(image)];
+    if (ArchiveRing::addDay(image, summary, staged, final) && !write(staged)) return false;   // Frees the slots the new days go in
+    if (!write(final)) return false;
+
+    Log.infoln("Day %u archived - %l seconds in %d sessions, peak hour %d - %d days held", summary.day, summary.occupiedSec, summary.sessions, summary.peakHour, count());
+    startTally(today);
+    return true;
+}
+
+bool dailyArchive::getDay(uint8_t daysBack, daySummary &summary) {
+    if (daysBack >= count()) return false;
+    ArchiveRing::readDay(image, count() - 1 - daysBack, summary);
+    return (summary.peakHour != ARCHIVE_GAP);
+}
+
+void dailyArchive::printArchive() {
+    Log.infoln("Daily archive - %d of %d days", count(), ARCHIVE_MAX_DAYS);
+    for (uint8_t i = 0; i < count(); i++) {
+        daySummary summary;
+        ArchiveRing::readDay(image, i, summary);
+        if (summary.peakHour == ARCHIVE_GAP) Log.infoln("Day %u: not recorded", summary.day);
+        else Log.infoln("Day %u: %l seconds, %d sessions, peak hour %d", summary.day, summary.occupiedSec, summary.sessions, summary.peakHour);
+    }
+}
+
+bool dailyArchive::write(uint8_t *newImage) {
+    ArchiveRing::seal(newImage);
+
+    // Data first, header last - the header's CRC commits the new day
+    uint8_t pages = 0;
+    if (!writeChangedPages(ARCHIVE_START + ARCHIVE_HEADER_SIZE, &newImage[ARCHIVE_HEADER_SIZE], &image[ARCHIVE_HEADER_SIZE], ARCHIVE_DATA_SIZE, pages) ||
+        !writeChangedPages(ARCHIVE_START, newImage, image, ARCHIVE_HEADER_SIZE, pages)) {
+        Log.infoln("Daily archive not written - EEPROM write failed");
+        return false;
+    }
+    Log.infoln("Daily archive written - %d page(s)", pages);
+    return true;
+}
+
+void dailyArchive::addSeconds(dayStats &stats, uint8_t hour, uint32_t seconds) {
+    if (hour != stats.hour) {
+        if (stats.hourSec > stats.peakSec) {
+            stats.peakSec = stats.hourSec;
+            stats.peakHour = stats.hour;
+        }
+        stats.hour = hour;
+        stats.hourSec = 0;
+    }
+    stats.hourSec += seconds;
+    stats.occupiedSec += seconds;
+}
+
+void dailyArchive::loadStats(dayStats &stats) {
+    if (!rtcMem.get(RTC_KEY_DAY_STATS, stats)) {
+        memset(&stats, 0, sizeof(stats));
+        stats.day = timeFunctions.getTime() / 86400L;
+    }
+}
+
+void dailyArchive::startTally(uint16_t day) {
+    dayStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.day = day;
+    rtcMem.put(RTC_KEY_DAY_STATS, stats);
+}
@@ -0,0 +1,143 @@
+/**
+ * @file    dailyArchive.h
+ * @author  Chip McClelland (chip@seeinsights.com)
+ * @brief   Ring of daily occupancy summaries in the top half of the EEPROM so missed uplinks can be backfilled
+ * @details At each daily rollover the day's occupied seconds, number of occupancy sessions and busiest hour (GMT)
+ * are appended.  Days run midnight to midnight on the RTC (eventFlag_dailyRollover).  While the day is running,
+ * its tally lives in RTC RAM (rtcStore) so a reset does not lose it, and the tally carries its own day so a day
+ * that ended while the device was off is still archived under the right date.
+ *
+ * Archive layout (ARCHIVE_START - see MyData.h, the rules for changing it are in archiveRing.h):
+ *      00 - Header: magic, days stored, oldest day (days since 1970, uint16), slot of the oldest day,
+ *           CRC-16 over the header and the days it holds
+ *      08 - Ring of ARCHIVE_SLOTS day records, one per calendar day.  Each record is 24 bits, little-endian
+ *              bits 0-4    peak hour (ARCHIVE_NO_PEAK if the space was never occupied, ARCHIVE_GAP if the day was not recorded)
+ *              bits 5-15   occupied minutes (0-1440)
+ *              bits 16-23  sessions (stops at 255)
+ *
+ * Every record is the same size, so the archive always holds the last ARCHIVE_MAX_DAYS (31) calendar days, gaps
+ * included.  A varint/delta coding averaged about the same 3 bytes a day but needed up to 7, which could not
+ * guarantee 30 days.  Closing a day writes its record (one or two pages) and then the header page, which commits it.
+ *
+ * @version 0.1
+ * @date    2024-10-20
+ *
+ */
+
+#ifndef __DAILYARCHIVE_H
+#define __DAILYARCHIVE_H
+
+#include <arduino.h>
+#include <ArduinoLog.h>
+#include "MyData.h"
+#include "rtcStore.h"
+#include "archiveRing.h"
+
+#define archive dailyArchive::instance()
+
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * From global application setup call dailyArchive::instance().setup() once the system and current data are set up.
+ * Presence calls recordSession() as each occupancy period ends and the main loop calls closeDay() at the rollover.
+ */
+class dailyArchive {
+public:
+    typedef ArchiveRing::daySummary daySummary;
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use dailyArchive::instance() to instantiate the singleton.
+     */
+    static dailyArchive &instance();
+
+    /**
+     * @brief Reads the archive into RAM and checks it - starts an empty one if the CRC fails.  Closes the tally
+     * if its day ended while the device was off.
+     */
+    bool setup();
+
+    /**
+     * @brief Adds an occupancy period to today's tally - closes the tally first if its day has ended
+     */
+    void recordSession(time_t start, time_t end);
+
+    /**
+     * @brief If the tally's day has ended, appends its summary and starts today's tally
+     *
+     * @returns false if the day could not be written - the tally is kept for the next try
+     */
+    bool closeDay();
+
+    /**
+     * @brief Number of calendar days held, including any that were not recorded
+     */
+    uint8_t count() const { return image[1]; }
+
+    /**
+     * @brief Gets a stored day for the gateway backfill - occupied time comes back in whole minutes
+     *
+     * @param daysBack - 0 is the most recent day stored
+     *
+     * @returns false if there are not that many days or the day was not recorded
+     */
+    bool getDay(uint8_t daysBack, daySummary &summary);
+
+    /**
+     * @brief Logs every stored day
+     */
+    void printArchive();
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use dailyArchive::instance() to instantiate the singleton.
+     */
+    dailyArchive();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~dailyArchive();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    dailyArchive(const dailyArchive&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    dailyArchive& operator=(const dailyArchive&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static dailyArchive *_instance;
+
+    // Today's tally - kept in RTC RAM under RTC_KEY_DAY_STATS
+    struct dayStats {
+        uint32_t occupiedSec;
+        uint16_t day;                                   // Days since 1970 the tally was started on
+        uint16_t sessions;
+        uint16_t hourSec;                               // Occupied seconds in hour so far
+        uint16_t peakSec;                               // Occupied seconds in peakHour
+        uint8_t hour;                                   // Hour being tallied - sessions end in time order so hours only move forward
+        uint8_t peakHour;
+    };
+    static_assert(sizeof(dayStats) <= RTCSTORE_DATA_SIZE, "dayStats must fit in an rtcStore slot");
+
+    bool write(uint8_t *newImage);
+    void addSeconds(dayStats &stats, uint8_t hour, uint32_t seconds);
+    void loadStats(dayStats &stats);
+    void startTally(uint16_t day);
+
+    uint8_t image[ARCHIVE_IMAGE_SIZE];                  // What the EEPROM holds
+};
+
+#endif  /* __DAILYARCHIVE_H */
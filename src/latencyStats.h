@@ -0,0 +1,72 @@
+/**
+ * @file    latencyStats.h
+ * @author  Chip McClelland (chip@seeinsights.com)
+ * @brief   Lightweight min / average / max / histogram accumulator for latency measurements
+ * @details Samples are recorded in microseconds.  The histogram uses power-of-two millisecond buckets:
+ *          <1ms, <2ms, <4ms ... <2048ms and a final bucket for anything longer.
+ * @version 0.1
+ * @date    2024-10-19
+ *
+ * Version History:
+ * 0.1 - Initial realease
+ *
+ */
+
+//Include a standard header guard
+#ifndef __LATENCYSTATS_H
+#define __LATENCYSTATS_H
+
+//Include standard header files from libraries:
+#include <arduino.h>
+#include <ArduinoLog.h>
+
+#define LATENCY_BUCKETS 13                              // 12 power of two buckets (1ms to 2048ms) plus one for longer
+
+struct latencyStats {
+    uint32_t count;                                     // Number of samples
+    uint32_t minUs;                                     // Shortest sample
+    uint32_t maxUs;                                     // Longest sample
+    uint64_t totalUs;                                   // Sum of all samples for the average
+    uint16_t histogram[LATENCY_BUCKETS];                // Sample counts per bucket
+
+    void reset() {
+        count = 0;
+        minUs = 0xFFFFFFFF;
+        maxUs = 0;
+        totalUs = 0;
+        memset(histogram, 0, sizeof(histogram));
+    }
+
+    void record(uint32_t us) {
+        count++;
+        if (us < minUs) minUs = us;
+        if (us > maxUs) maxUs = us;
+        totalUs += us;
+        uint8_t bucket = 0;
+        uint32_t ms = us / 1000UL;
+        while (ms > 0 && bucket < LATENCY_BUCKETS - 1) {  // Bucket is the number of significant bits in ms
+            ms >>= 1;
+            bucket++;
+        }
+        if (histogram[bucket] < 0xFFFF) histogram[bucket]++;
+    }
+
+    uint32_t average() const {
+        return (count) ? (uint32_t)(totalUs / count) : 0;
+    }
+
+    void print(const char *name) const {
+        if (!count) {
+            Log.infoln("%s: no samples", name);
+            return;
+        }
+        Log.infoln("%s: n=%u min=%uus avg=%uus max=%uus", name, count, minUs, average(), maxUs);
+        for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+            if (!histogram[i]) continue;
+            if (i == LATENCY_BUCKETS - 1) Log.infoln("   >=%ums: %u", 1UL << (i - 1), histogram[i]);
+            else Log.infoln("   <%ums: %u", 1UL << i, histogram[i]);
+        }
+    }
+};
+
+#endif  /* __LATENCYSTATS_H */
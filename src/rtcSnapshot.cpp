@@ -0,0 +1,74 @@
+#include "rtcSnapshot.h"
+
+rtcSnapshot *rtcSnapshot::_instance;
+
+// [static]
+rtcSnapshot &rtcSnapshot::instance() {
+    if (!_instance) {
+        _instance = new rtcSnapshot();
+    }
+    return *_instance;
+}
+
+rtcSnapshot::rtcSnapshot() {
+    memset(&data, 0, sizeof(data));
+}
+
+rtcSnapshot::~rtcSnapshot() {
+}
+
+bool rtcSnapshot::save(uint8_t appState) {
+    memset(&data, 0, sizeof(data));                             // Padding bytes are covered by the CRC
+    data.magic = SNAPSHOT_MAGIC;
+    data.version = SNAPSHOT_VERSION;
+    data.length = sizeof(data);
+    data.appState = appState;
+    data.savedAt = timeFunctions.getTime();
+    Presence::instance().getContext(data.presence);
+    for (uint8_t i = 0; i < AMBIENT_AXES; i++) data.thresholds[i] = TapSensor::instance().getThreshold(i);
+    data.sys = sysStatus;
+    data.cur = current;
+    data.crc = rtcStore::crc16((const uint8_t *)&data, offsetof(snapshotData, crc));
+
+    if (!ab1805.writeRam(SNAPSHOT_ADDR, (const uint8_t *)&data, sizeof(data))) {
+        Log.infoln("Snapshot could not be written to RTC RAM");
+        return false;
+    }
+    Log.infoln("Snapshot of %d bytes saved at %l", sizeof(data), data.savedAt);
+    return true;
+}
+
+bool rtcSnapshot::restore(uint8_t &appState) {
+    restored = false;
+    if (ab1805.getWakeReason() != AB1805::WakeReason::DEEP_POWER_DOWN) return false;   // Only a planned power-down leaves a current snapshot
+
+    if (!ab1805.readRam(SNAPSHOT_ADDR, (uint8_t *)&data, sizeof(data))) return false;
+    if (data.magic != SNAPSHOT_MAGIC || data.version != SNAPSHOT_VERSION || data.length != sizeof(data)
+        || data.crc != rtcStore::crc16((const uint8_t *)&data, offsetof(snapshotData, crc))) {
+        Log.infoln("Woke from deep power down without a valid snapshot - full setup");
+        return false;
+    }
+
+    if (!sysData.resume(data.sys)) return false;
+    currentData.resume(data.cur);
+    appState = data.appState;
+    restored = true;
+    invalidate();                                               // One use only - a later reset must not see stale state
+
+    Log.infoln("Resuming from snapshot taken %l seconds ago", timeFunctions.getTime() - data.savedAt);
+    return true;
+}
+
+void rtcSnapshot::resumeSensors() {
+    if (!restored) return;
+
+    Presence::instance().setContext(data.presence);
+    if (data.thresholds[0] && data.thresholds[1] && data.thresholds[2]) {
+        TapSensor::instance().applyThresholds(data.thresholds[0], data.thresholds[1], data.thresholds[2]);
+    }
+}
+
+void rtcSnapshot::invalidate() {
+    uint8_t blank = 0;
+    ab1805.writeRam(SNAPSHOT_ADDR, &blank, 1);                  // Clearing the magic is enough
+}
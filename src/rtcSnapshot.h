@@ -0,0 +1,123 @@
+/**
+ * @file    rtcSnapshot.h
+ * @author  Chip McClelland (chip@seeinsights.com)
+ * @brief   Saves the live context to the upper half of the AB1805 RAM before deepPowerDown() so the next boot can resume
+ * @details deepPowerDown() removes power from the MCU, so the wake is a full reset.  When the wake reason is
+ * DEEP_POWER_DOWN and a valid snapshot is found, setup() can skip the serial delay, the EEPROM reads, the tap
+ * test window and the ambient threshold learning, and carry on with the saved state machine and presence state.
+ * The snapshot is invalidated once it has been restored so it can only be used once.
+ *
+ * @version 0.1
+ * @date    2024-10-20
+ *
+ */
+
+#ifndef __RTCSNAPSHOT_H
+#define __RTCSNAPSHOT_H
+
+#include <arduino.h>
+#include <ArduinoLog.h>
+#include "timing.h"
+#include "rtcStore.h"
+#include "MyData.h"
+#include "Presence/Presence.h"
+
+#define snapshot rtcSnapshot::instance()
+
+#define SNAPSHOT_ADDR 0x80                              // Upper half of RTC RAM - the lower half belongs to rtcStore
+#define SNAPSHOT_MAX_SIZE 128
+#define SNAPSHOT_MAGIC 0x5A
+#define SNAPSHOT_VERSION 1
+
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * Before timing::instance().deepPowerDown() call rtcSnapshot::instance().save(state).
+ * In setup(), after timing::instance().setup(), call restore() - if it returns true use the resume paths,
+ * then call resumeSensors() once the sensors have been set up.
+ */
+class rtcSnapshot {
+public:
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use rtcSnapshot::instance() to instantiate the singleton.
+     */
+    static rtcSnapshot &instance();
+
+    /**
+     * @brief Capture the application state, presence state, tap thresholds and the data structures
+     *
+     * @param appState - the main state machine's state to resume in
+     */
+    bool save(uint8_t appState);
+
+    /**
+     * @brief Looks for a snapshot left by a planned deepPowerDown() and restores sysStatus and current from it
+     *
+     * @param appState - set to the saved state machine state if a snapshot was restored
+     *
+     * @returns true if the boot can take the fast-resume path
+     */
+    bool restore(uint8_t &appState);
+
+    /**
+     * @brief Puts the presence state machine and the tap thresholds back - call after measure.setup()
+     */
+    void resumeSensors();
+
+    /**
+     * @brief Mark the snapshot as used
+     */
+    void invalidate();
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use rtcSnapshot::instance() to instantiate the singleton.
+     */
+    rtcSnapshot();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~rtcSnapshot();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    rtcSnapshot(const rtcSnapshot&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    rtcSnapshot& operator=(const rtcSnapshot&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static rtcSnapshot *_instance;
+
+    struct snapshotData {
+        uint8_t magic;
+        uint8_t version;
+        uint8_t length;                                 // sizeof(snapshotData) - catches a layout change without a version bump
+        uint8_t appState;
+        time_t savedAt;                                 // RTC time when the snapshot was taken
+        Presence::presenceContext presence;
+        uint8_t thresholds[AMBIENT_AXES];               // PULSE_THSx values learned from the ambient floor (0 = not learned)
+        sysStatusData::SystemDataStructure sys;
+        currentStatusData::CurrentDataStructure cur;
+        uint16_t crc;                                   // Over everything above
+    };
+    static_assert(sizeof(snapshotData) <= SNAPSHOT_MAX_SIZE, "Snapshot no longer fits in the upper half of RTC RAM");
+
+    snapshotData data;
+    bool restored = false;
+};
+
+#endif  /* __RTCSNAPSHOT_H */
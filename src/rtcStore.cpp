@@ -0,0 +1,118 @@
+#include "rtcStore.h"
+#include "rtcSnapshot.h"
+
+rtcStore *rtcStore::_instance;
+
+static_assert(RTCSTORE_END <= SNAPSHOT_ADDR, "rtcStore has grown into the rtcSnapshot half of RTC RAM");
+
+// [static]
+rtcStore &rtcStore::instance() {
+    if (!_instance) {
+        _instance = new rtcStore();
+    }
+    return *_instance;
+}
+
+rtcStore::rtcStore() {
+    memset(directory, RTCSTORE_KEY_FREE, sizeof(directory));
+}
+
+rtcStore::~rtcStore() {
+}
+
+bool rtcStore::setup() {
+    uint8_t buf[RTCSTORE_DIR_ADDR + RTCSTORE_SLOTS];        // Header and directory in one read
+
+    if (!ab1805.readRam(RTCSTORE_HEADER_ADDR, buf, sizeof(buf)) || buf[0] != RTCSTORE_MAGIC || buf[1] != RTCSTORE_VERSION || buf[2] != RTCSTORE_SLOTS) {
+        Log.infoln("RTC RAM store not found - formatting");
+        format();
+        return false;
+    }
+
+    memcpy(directory, &buf[RTCSTORE_DIR_ADDR], RTCSTORE_SLOTS);
+    ready = true;
+
+    uint8_t used = 0;
+    for (uint8_t i = 0; i < RTCSTORE_SLOTS; i++) if (directory[i] != RTCSTORE_KEY_FREE) used++;
+    Log.infoln("RTC RAM store loaded with %d of %d slots in use", used, RTCSTORE_SLOTS);
+    return true;
+}
+
+bool rtcStore::format() {
+    uint8_t buf[RTCSTORE_DIR_ADDR + RTCSTORE_SLOTS];
+
+    buf[0] = RTCSTORE_MAGIC;
+    buf[1] = RTCSTORE_VERSION;
+    buf[2] = RTCSTORE_SLOTS;
+    buf[3] = 0;
+    memset(&buf[RTCSTORE_DIR_ADDR], RTCSTORE_KEY_FREE, RTCSTORE_SLOTS);
+    memset(directory, RTCSTORE_KEY_FREE, sizeof(directory));
+
+    ready = ab1805.writeRam(RTCSTORE_HEADER_ADDR, buf, sizeof(buf));
+    return ready;
+}
+
+bool rtcStore::remove(uint8_t key) {
+    int slot = findSlot(key);
+    if (slot < 0) return true;
+
+    uint8_t freeKey = RTCSTORE_KEY_FREE;
+    if (!ab1805.writeRam(RTCSTORE_DIR_ADDR + slot, &freeKey, 1)) return false;
+    directory[slot] = RTCSTORE_KEY_FREE;
+    return true;
+}
+
+int rtcStore::findSlot(uint8_t key) const {
+    for (uint8_t i = 0; i < RTCSTORE_SLOTS; i++) {
+        if (directory[i] == key) return i;
+    }
+    return -1;
+}
+
+bool rtcStore::read(uint8_t key, uint8_t *data, uint8_t len) {
+    int slot = findSlot(key);
+    if (!ready || slot < 0) return false;
+
+    uint8_t buf[RTCSTORE_SLOT_SIZE];
+    if (!ab1805.readRam(RTCSTORE_SLOT_ADDR + slot * RTCSTORE_SLOT_SIZE, buf, sizeof(buf))) return false;
+
+    uint16_t crc = buf[RTCSTORE_SLOT_SIZE - 2] | (buf[RTCSTORE_SLOT_SIZE - 1] << 8);
+    if (buf[0] != key || buf[1] != len || crc != crc16(buf, RTCSTORE_SLOT_SIZE - 2)) {
+        Log.infoln("RTC RAM key %d is corrupt", key);
+        return false;
+    }
+
+    memcpy(data, &buf[2], len);
+    return true;
+}
+
+bool rtcStore::write(uint8_t key, const uint8_t *data, uint8_t len) {
+    if (!ready || key == 0 || key == RTCSTORE_KEY_FREE) return false;
+
+    int slot = findSlot(key);
+    bool newKey = (slot < 0);
+    if (newKey) {
+        slot = findSlot(RTCSTORE_KEY_FREE);
+        if (slot < 0) {
+            Log.infoln("RTC RAM store is full - key %d not saved", key);
+            return false;
+        }
+    }
+
+    uint8_t buf[RTCSTORE_SLOT_SIZE];
+    memset(buf, 0, sizeof(buf));
+    buf[0] = key;                                           // The key is repeated in the slot so the CRC covers it
+    buf[1] = len;
+    memcpy(&buf[2], data, len);
+    uint16_t crc = crc16(buf, RTCSTORE_SLOT_SIZE - 2);
+    buf[RTCSTORE_SLOT_SIZE - 2] = crc & 0xFF;
+    buf[RTCSTORE_SLOT_SIZE - 1] = crc >> 8;
+
+    if (!ab1805.writeRam(RTCSTORE_SLOT_ADDR + slot * RTCSTORE_SLOT_SIZE, buf, sizeof(buf))) return false;
+
+    if (newKey) {                                           // Claim the slot only once its data is in place
+        if (!ab1805.writeRam(RTCSTORE_DIR_ADDR + slot, &key, 1)) return false;
+        directory[slot] = key;
+    }
+    return true;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file    rtcStore.h
+ * @author  Chip McClelland (chip@seeinsights.com)
+ * @brief   Small typed key-value store in the AB1805's battery-backed RAM
+ * @details The 24XX02 EEPROM takes ~5 msec per page write and wears out, so small state that has to outlive a
+ * reset (drift correction, the task that starved the watchdog, today's session tally) lives here instead.
+ * Writes are a single I2C transaction and unlimited.
+ *
+ * RTC RAM layout (the lower 128 bytes - the upper half is left for other users):
+ *      0x00 - Header: magic, layout version, number of slots, reserved
+ *      0x04 - Directory: one key per slot (RTCSTORE_KEY_FREE if the slot is unused)
+ *      0x10 - Slots: key, length, 16 data bytes, CRC16 - 20 bytes each
+ *      0x80 - Not used here - rtcSnapshot keeps the deepPowerDown() context in the upper half
+ *
+ * @version 0.1
+ * @date    2024-10-20
+ *
+ */
+
+#ifndef __RTCSTORE_H
+#define __RTCSTORE_H
+
+#include <arduino.h>
+#include <ArduinoLog.h>
+#include "timing.h"
+#include "crc16.h"
+
+#define rtcMem rtcStore::instance()
+
+#define RTCSTORE_MAGIC 0xA5
+#define RTCSTORE_VERSION 2                              // 1 had nine 8-byte slots
+#define RTCSTORE_SLOTS 5
+#define RTCSTORE_DATA_SIZE 16                           // Largest value a slot can hold
+#define RTCSTORE_HEADER_ADDR 0x00
+#define RTCSTORE_DIR_ADDR 0x04
+#define RTCSTORE_SLOT_ADDR 0x10
+#define RTCSTORE_SLOT_SIZE (RTCSTORE_DATA_SIZE + 4)
+#define RTCSTORE_END (RTCSTORE_SLOT_ADDR + RTCSTORE_SLOTS * RTCSTORE_SLOT_SIZE)   // First byte not used by the store
+
+// Keys - 0 and 0xFF are reserved
+#define RTCSTORE_KEY_FREE 0xFF
+#define RTC_KEY_PPM_ADJ 1                               // int16_t  - drift correction applied with setPPMAdj()
+#define RTC_KEY_WDT_TASK 2                              // uint8_t  - task that last starved the watchdog
+#define RTC_KEY_DAY_STATS 3                             // dailyArchive::dayStats - the running day and its tally
+
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * timing::instance().setup() calls rtcStore::instance().setup() once the AB1805 is running.
+ */
+class rtcStore {
+public:
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use rtcStore::instance() to instantiate the singleton.
+     */
+    static rtcStore &instance();
+
+    /**
+     * @brief Reads the header and directory - formats the store if the RAM does not hold a valid one
+     *
+     * @returns true if an existing store was found, false if the store was (re)formatted
+     */
+    bool setup();
+
+    /**
+     * @brief Erase every key
+     */
+    bool format();
+
+    /**
+     * @brief Read a value
+     *
+     * @returns false (and leaves value alone) if the key is missing, the size does not match or the CRC fails
+     */
+    template <typename T> bool get(uint8_t key, T &value) {
+        static_assert(sizeof(T) <= RTCSTORE_DATA_SIZE, "rtcStore values are limited to RTCSTORE_DATA_SIZE bytes");
+        return read(key, (uint8_t *)&value, sizeof(T));
+    }
+
+    /**
+     * @brief Write a value - creates the key if needed
+     *
+     * @returns false if the store is full or the RAM could not be written
+     */
+    template <typename T> bool put(uint8_t key, const T &value) {
+        static_assert(sizeof(T) <= RTCSTORE_DATA_SIZE, "rtcStore values are limited to RTCSTORE_DATA_SIZE bytes");
+        return write(key, (const uint8_t *)&value, sizeof(T));
+    }
+
+    /**
+     * @brief Remove a key and free its slot
+     */
+    bool remove(uint8_t key);
+
+    /**
+     * @brief True if the key is in the directory
+     */
+    bool contains(uint8_t key) const { return findSlot(key) >= 0; }
+
+    /**
+     * @brief CRC-16/CCITT-FALSE - also used by rtcSnapshot and the EEPROM system data banks
+     */
+    static uint16_t crc16(const uint8_t *data, size_t len) { return crc16Ccitt(data, len); }
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use rtcStore::instance() to instantiate the singleton.
+     */
+    rtcStore();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~rtcStore();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    rtcStore(const rtcStore&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    rtcStore& operator=(const rtcStore&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static rtcStore *_instance;
+
+    bool read(uint8_t key, uint8_t *data, uint8_t len);
+    bool write(uint8_t key, const uint8_t *data, uint8_t len);
+    int findSlot(uint8_t key) const;
+
+    uint8_t directory[RTCSTORE_SLOTS];                  // RAM copy of the directory - lookups never touch I2C
+    bool ready = false;
+};
+
+#endif  /* __RTCSTORE_H */
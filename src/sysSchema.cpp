@@ -0,0 +1,170 @@
+#include "sysSchema.h"
+#include "Config.h"
+
+typedef sysStatusData::SystemDataStructure sysLayout;
+
+// STRUCTURES_VERSION - the packed image
+#define PACKED_ENTRY(id, type, name, offset, size, value) { id, offset, size, (uint32_t)(value) },
+static constexpr sysSchema::field packedFields[] = { SYS_SCHEMA_FIELDS(PACKED_ENTRY) };
+#undef PACKED_ENTRY
+
+static const sysSchema::version currentSchema = {
+    STRUCTURES_VERSION, SYS_IMAGE_SIZE, packedFields, sizeof(packedFields) / sizeof(packedFields[0])
+};
+
+// SystemDataStructure as it sits in RAM - whatever the compiler chose
+#define NATIVE_ENTRY(id, type, name, offset, size, value) { id, offsetof(sysLayout, name), sizeof(sysLayout::name), (uint32_t)(value) },
+static const sysSchema::field nativeFields[] = { SYS_SCHEMA_FIELDS(NATIVE_ENTRY) };
+#undef NATIVE_ENTRY
+
+static const sysSchema::version nativeSchema = {
+    STRUCTURES_VERSION, sizeof(sysLayout), nativeFields, sizeof(nativeFields) / sizeof(nativeFields[0])
+};
+
+// The packed fields must follow each other with no gaps and end at SYS_IMAGE_SIZE
+static constexpr bool packedContiguous(const sysSchema::field *f, size_t count, uint8_t offset) {
+    return (count == 0) ? offset == SYS_IMAGE_SIZE : (f->offset == offset && packedContiguous(f + 1, count - 1, offset + f->size));
+}
+static_assert(packedFields[0].id == SYS_FIELD_STRUCTURES_VERSION && packedFields[0].offset == 0, "Every stored image starts with its version so the schema can be found");
+static_assert(packedContiguous(packedFields, sizeof(packedFields) / sizeof(packedFields[0]), 0), "SYS_SCHEMA_FIELDS offsets must be contiguous and add up to SYS_IMAGE_SIZE");
+
+#define SIZE_CHECK(id, type, name, offset, size, value) static_assert(size <= sizeof(sysLayout::name), "Packed " #name " is wider than the structure field");
+SYS_SCHEMA_FIELDS(SIZE_CHECK)
+#undef SIZE_CHECK
+
+
+// Version 18 stored SystemDataStructure exactly as the compiler laid it out - frozen, never edit
+struct sysLayoutV18 {
+    uint8_t structuresVersion;
+    uint8_t firmwareRelease;
+    uint16_t magicNumber;
+    uint8_t nodeNumber;
+    uint16_t token;
+    uint32_t uniqueID;
+    uint8_t resetCount;
+    time_t lastConnection;
+    time_t nextConnection;
+    uint8_t alertCodeNode;
+    uint16_t alertContextNode;
+    uint8_t sensorType;
+    uint8_t space;
+    uint8_t placement;
+    uint8_t multi;
+    uint8_t zoneMode;
+    uint16_t interferenceBuffer;
+    uint16_t occupancyCalibrationLoops;
+    uint8_t distanceMode;
+    uint8_t tofDetectionsPerSecond;
+    uint8_t sensitivity;
+    uint8_t debounceMin;
+};
+
+#define V18_ENTRY(id, name, value) { id, offsetof(sysLayoutV18, name), sizeof(sysLayoutV18::name), (uint32_t)(value) }
+static const sysSchema::field v18Fields[] = {
+    V18_ENTRY(1,  structuresVersion,          18),
+    V18_ENTRY(2,  firmwareRelease,            255),
+    V18_ENTRY(3,  magicNumber,                27617),
+    V18_ENTRY(4,  nodeNumber,                 255),
+    V18_ENTRY(5,  token,                      0),
+    V18_ENTRY(6,  uniqueID,                   0xFFFFFFFF),
+    V18_ENTRY(7,  resetCount,                 0),
+    V18_ENTRY(8,  lastConnection,             0),
+    V18_ENTRY(9,  nextConnection,             0),
+    V18_ENTRY(10, alertCodeNode,              1),
+    V18_ENTRY(11, alertContextNode,           0),
+    V18_ENTRY(12, sensorType,                 0),
+    V18_ENTRY(13, space,                      0),
+    V18_ENTRY(14, placement,                  0),
+    V18_ENTRY(15, multi,                      0),
+    V18_ENTRY(16, zoneMode,                   0),
+    V18_ENTRY(17, interferenceBuffer,         500),
+    V18_ENTRY(18, occupancyCalibrationLoops,  30),
+    V18_ENTRY(19, distanceMode,               1),
+    V18_ENTRY(20, tofDetectionsPerSecond,     10),
+    V18_ENTRY(21, sensitivity,                1),
+    V18_ENTRY(22, debounceMin,                1),
+};
+#undef V18_ENTRY
+
+static const sysSchema::version v18Schema = {
+    18, sizeof(sysLayoutV18), v18Fields, sizeof(v18Fields) / sizeof(v18Fields[0])
+};
+
+// Layouts that have been in the field - frozen once STRUCTURES_VERSION moves on, never edit an entry, only add one
+static const sysSchema::version *const history[] = {
+    &v18Schema,
+    &currentSchema,
+};
+
+
+// [static]
+const sysSchema::version *sysSchema::find(uint8_t number) {
+    for (size_t i = 0; i < sizeof(history) / sizeof(history[0]); i++) {
+        if (history[i]->number == number) return history[i];
+    }
+    return NULL;
+}
+
+// [static]
+const sysSchema::version &sysSchema::currentVersion() {
+    return currentSchema;
+}
+
+// [static]
+const sysSchema::version &sysSchema::nativeLayout() {
+    return nativeSchema;
+}
+
+// [static]
+void sysSchema::serialize(const sysStatusData::SystemDataStructure &data, uint8_t *image) {
+    migrate((const uint8_t *)&data, nativeSchema, image, currentSchema);
+}
+
+// [static]
+uint8_t sysSchema::deserialize(const uint8_t *image, const version &from, sysStatusData::SystemDataStructure &data) {
+    return migrate(image, from, (uint8_t *)&data, nativeSchema);
+}
+
+// [static]
+uint8_t sysSchema::migrate(const uint8_t *src, const version &from, uint8_t *dst, const version &to) {
+    uint8_t defaulted = 0;
+
+    memset(dst, 0, to.imageSize);
+    for (uint8_t i = 0; i < to.fieldCount; i++) {
+        const field &f = to.fields[i];
+        const field *old = findField(from, f.id);
+        if (old) {
+            // Little-endian - a wider field is zero-extended, a narrower one keeps the low bytes
+            for (uint8_t b = 0; b < f.size; b++) dst[f.offset + b] = (b < old->size) ? src[old->offset + b] : 0;
+        }
+        else {
+            writeValue(&dst[f.offset], f.size, f.defaultValue);
+            defaulted++;
+        }
+    }
+
+    const field *ver = findField(to, SYS_FIELD_STRUCTURES_VERSION);
+    if (ver) writeValue(&dst[ver->offset], ver->size, to.number);
+    return defaulted;
+}
+
+// [static]
+void sysSchema::applyDefaults(uint8_t *dst, const version &to) {
+    memset(dst, 0, to.imageSize);
+    for (uint8_t i = 0; i < to.fieldCount; i++) writeValue(&dst[to.fields[i].offset], to.fields[i].size, to.fields[i].defaultValue);
+}
+
+// [static]
+const sysSchema::field *sysSchema::findField(const version &schema, uint8_t id) {
+    for (uint8_t i = 0; i < schema.fieldCount; i++) {
+        if (schema.fields[i].id == id) return &schema.fields[i];
+    }
+    return NULL;
+}
+
+// [static]
+void sysSchema::writeValue(uint8_t *dst, uint8_t size, uint32_t value) {
+    for (uint8_t b = 0; b < size; b++) {
+        dst[b] = (b < sizeof(value)) ? (value >> (8 * b)) & 0xFF : 0;
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file    sysSchema.h
+ * @author  Chip McClelland (chip@seeinsights.com)
+ * @brief   Declarative layout of the system data for each STRUCTURES_VERSION and the migration between them
+ * @details Every field has a permanent id.  A schema lists, for one version, where each field sits in the stored
+ * image and how big it is.  When a bank holds an older version, migrate() copies every field the two versions
+ * share (widening or narrowing integers as needed) and gives only the new fields their defaults - so a firmware
+ * update does not send the whole fleet back through provisioning.
+ *
+ * To change SystemDataStructure:
+ *   1 - Copy the outgoing layout into a frozen table in sysSchema.cpp and add it to the history list
+ *   2 - Edit SYS_SCHEMA_FIELDS in MyData.h (new fields get a new id and go at the end - never reuse an id)
+ *   3 - Bump STRUCTURES_VERSION
+ *
+ * @version 0.1
+ * @date    2024-10-20
+ *
+ */
+
+#ifndef __SYSSCHEMA_H
+#define __SYSSCHEMA_H
+
+#include <arduino.h>
+#include <ArduinoLog.h>
+#include "MyData.h"
+
+#define SYS_FIELD_STRUCTURES_VERSION 1                  // Always rewritten by migrate()
+#define SYS_FIELD_UNIQUE_ID 6                           // Kept from the protected copy at address 1 by initialize()
+
+
+class sysSchema {
+public:
+    struct field {
+        uint8_t id;
+        uint8_t offset;                                 // Byte offset in the stored image
+        uint8_t size;                                   // Little-endian integer of this many bytes
+        uint32_t defaultValue;
+    };
+
+    struct version {
+        uint8_t number;                                 // STRUCTURES_VERSION that wrote this layout
+        uint8_t imageSize;
+        const field *fields;
+        uint8_t fieldCount;
+    };
+
+    /**
+     * @brief The schema for a stored version, or NULL if the layout is unknown and the data cannot be migrated
+     */
+    static const version *find(uint8_t number);
+
+    /**
+     * @brief The stored layout for STRUCTURES_VERSION - generated from SYS_SCHEMA_FIELDS
+     */
+    static const version &currentVersion();
+
+    /**
+     * @brief The layout of SystemDataStructure in RAM
+     */
+    static const version &nativeLayout();
+
+    /**
+     * @brief Packs the structure into a STRUCTURES_VERSION image of SYS_IMAGE_SIZE bytes
+     */
+    static void serialize(const sysStatusData::SystemDataStructure &data, uint8_t *image);
+
+    /**
+     * @brief Unpacks an image of any version in the history - fields it does not have get their defaults
+     *
+     * @returns the number of fields that had to be defaulted
+     */
+    static uint8_t deserialize(const uint8_t *image, const version &from, sysStatusData::SystemDataStructure &data);
+
+    /**
+     * @brief Rebuilds an image in the layout of to from an image in the layout of from
+     *
+     * Fields the two have in common are copied, fields only in to get their defaults and fields only in from are dropped.
+     *
+     * @returns the number of fields that had to be defaulted
+     */
+    static uint8_t migrate(const uint8_t *src, const version &from, uint8_t *dst, const version &to);
+
+    /**
+     * @brief Sets every field of an image to its default
+     */
+    static void applyDefaults(uint8_t *dst, const version &to);
+
+protected:
+    static const field *findField(const version &schema, uint8_t id);
+    static void writeValue(uint8_t *dst, uint8_t size, uint32_t value);
+};
+
+#endif  /* __SYSSCHEMA_H */
@@ -1,4 +1,5 @@
 #include "take_measurements.h"
+#include "writeBehind.h"
 
 Adafruit_MAX17048 maxlipo;                  // Class instance for MAX17048 battery fuel gauge
 Adafruit_SHT31 sht31 = Adafruit_SHT31();    // And the SHT31-D temperature and humidity sensor
@@ -43,10 +44,10 @@ bool take_measurements::setup() {
     if (digitalRead(gpio.BATTINT) == LOW) {                       // If the interrupt is active low there is an alert (need to determine what the alert is for)
       if (maxlipo.cellVoltage() > 3.7) {
         maxlipo.clearAlertFlag(0x00);                             // If the voltage is above 3.7V then we can clear the alert flag
-        current.batteryState = 1;                                 // This is the state where the battery is 10% or more
+        currentData.set_batteryState(1);                          // This is the state where the battery is 10% or more
       }
       else {
-        current.batteryState = 0;                                 // This is the state where the battery is less than 10%
+        currentData.set_batteryState(0);                          // This is the state where the battery is less than 10%
       }
     }
     byte activeAlert = maxlipo.getAlertStatus();                  // Get the alert status
@@ -64,10 +65,11 @@ bool take_measurements::setup() {
 
 bool take_measurements::takeMeasurements() { 
     bool returnResult = false;
+    uint8_t previousBatteryState = current.batteryState;
     if (!take_measurements::getTemperatureHumidity()) returnResult = false;  // Temperature and humidity inside the enclosure
     if (!take_measurements::batteryState()) returnResult = false;// Using the Fuel guage
     if (!take_measurements::isItSafeToCharge()) returnResult = false; // This will be a safety check - Thermister on charge controller should manage
-    currentStatusData::instance().currentDataChanged = true; // This is a flag that will be used to indicate that the data has changed and needs to be saved
+    if (current.batteryState == 0 && previousBatteryState != 0) persistence.onLowBattery();   // Don't leave counts in RAM with a failing battery
     return returnResult;
 }
 
@@ -87,8 +89,8 @@ bool take_measurements::getTemperatureHumidity() {
     return false;
   }
 
-  current.internalTempC = t;
-  current.internalHumidity = h;
+  currentData.set_internalTempC(t);
+  currentData.set_internalHumidity(h);
   Log.infoln("Temperature is %FC and Humidity is %F%%",t,h);
   return true;
 
@@ -105,12 +107,16 @@ bool take_measurements::batteryState() {                              // This fu
   if (digitalRead(gpio.BATTINT) == LOW) {                             // If the interrupt is active low there is an alert (need to determine what the alert is for)
     byte activeAlert = maxlipo.getAlertStatus();                  // Get the alert status
     Log.infoln("Battery alert value of %d which is %s and battery interrupt is %s battery voltage at %FV and charge at %F%%", activeAlert, (activeAlert | 0b00000010)? "active" : "not active", (digitalRead(gpio.BATTINT)) ? "HIGH" : "LOW", maxlipo.cellVoltage(), maxlipo.cellPercent());
-    if (maxlipo.cellVoltage() < 3.7) current.batteryState = 0;                                   // This is the state where the battery is less than 10%
+    if (maxlipo.cellVoltage() < 3.7) currentData.set_batteryState(0);                            // This is the state where the battery is less than 10%
+    else {                                                            // Recovered (charging) - clear the alert so the pin can signal the next drop
+      maxlipo.clearAlertFlag(0x00);
+      currentData.set_batteryState(1);
+    }
   }
   else {                                                              // If the interrupt high then we are above 3.7V 
     if (maxlipo.cellVoltage() >=3.7) {
       maxlipo.clearAlertFlag(0x00);                                   // Clear all the alert flags
-      current.batteryState = 1;                                       // This is the state where the battery is 10% or more
+      currentData.set_batteryState(1);                                // This is the state where the battery is 10% or more
     }
   }
 
@@ -122,12 +128,12 @@ bool take_measurements::batteryState() {                              // This fu
 
   float percent = maxlipo.cellPercent();                               // There is no error checking in the Adafruit lib - so, +100% is an invalid result
   if (percent < 0.00 || percent > 101.0) {
-    current.batteryState = 2;                                          // This indicates that we did not get a valid state of charge measurement
+    currentData.set_batteryState(2);                                   // This indicates that we did not get a valid state of charge measurement
     Log.infoln("Failed to get battery percent charge - %F%%", percent);
     return false;
   }
 
-  current.stateOfCharge = percent;                                     // This stores the value in 8bits (we don't need the float)
+  currentData.set_stateOfCharge(percent);                                     // This stores the value in 8bits (we don't need the float)
   Log.infoln("Batt Voltage: %FV and %F%% charged ", voltage, percent);
   return true;
 }
@@ -153,6 +159,7 @@ bool take_measurements::clearPresenceInterrupt() {
 }
 
 bool take_measurements::loop() {
+  timeFunctions.checkIn(wdtTask_measure);
   Presence::instance().loop();
   return true;
 }
\ No newline at end of file
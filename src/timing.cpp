@@ -1,4 +1,7 @@
 #include "timing.h"
+#include "rtcStore.h"
+#include "MyData.h"
+#include "Config.h"
 
 AB1805 ab1805(Wire); // Class instance for the the AB1805 RTC
 
@@ -13,6 +16,7 @@ timing &timing::instance() {
 }
 
 timing::timing() {
+  memset(wdtTasks, 0, sizeof(wdtTasks));
 }
 
 timing::~timing() {
@@ -23,11 +27,25 @@ bool timing::setup() {
   ab1805.withFOUT(gpio.WAKE).setup();
   ab1805.setWDT(ab1805.WATCHDOG_MAX_SECONDS);
 
-  ab1805.setRtcFromTime(1722075394+60); // Set the time to 1722075394 + 60 seconds
+  rtcMem.setup();                                   // Key-value store in the RTC's battery-backed RAM
+  if (rtcMem.get(RTC_KEY_PPM_ADJ, ppmAdjustment)) {  // The calibration register survives on the backup battery
+    Log.infoln("RTC calibration is %d ppm", ppmAdjustment);
+  }
+  if (ab1805.getWakeReason() == AB1805::WakeReason::WATCHDOG && rtcMem.get(RTC_KEY_WDT_TASK, stalledTask)) {
+    Log.infoln("Reset by the watchdog - task %d had stalled", stalledTask);
+  }
+  rtcMem.remove(RTC_KEY_WDT_TASK);
+
+  if (ab1805.getWakeReason() != AB1805::WakeReason::DEEP_POWER_DOWN) {    // The RTC kept time through a planned power down
+    ab1805.setRtcFromTime(1722075394+60); // Set the time to 1722075394 + 60 seconds
+  }
 
-  bool isRTCSet = ab1805.getRtcAsTime(time_cv,hundrths_cv);
+  bool isRTCSet = resync();
+  time_cv = anchorTime;
+  hundrths_cv = anchorHundredths;
   if (isRTCSet) {
     Log.infoln("AB1805 is set to %l", time_cv);
+    scheduleEvent(eventFlag_dailyRollover, (time_cv / 86400L + 1) * 86400L);   // Next midnight (GMT)
     return true;
   }
   else {
@@ -40,7 +58,9 @@ void timing::loop() {
     // static uint32_t lastTime = 0;
 
     // Put your code to run during the application thread loop here
-    ab1805.loop(); 
+    serviceWatchdog();                              // Replaces ab1805.loop() which pets the watchdog unconditionally
+
+    update();                                       // Fire any events that are due and re-arm the alarm
 
 /*
     if (millis() - lastTime > 10000) {
@@ -56,7 +76,12 @@ void timing::loop() {
  * Method Name: setTime()
  *******************************************************************************/
 bool timing::setTime(time_t UnixTime, uint8_t hundredths){
+  recordDrift(UnixTime, hundredths);
   ab1805.setRtcFromTime(UnixTime,hundredths);
+  anchorTime = UnixTime;                            // We just wrote the RTC so there is no need to read it back
+  anchorHundredths = hundredths;
+  anchorMillis = millis();
+  anchorValid = true;
   if (ab1805.isRTCSet()) {
     Log.infoln("AB1805 is set to %l", UnixTime);
     return true;
@@ -68,12 +93,36 @@ bool timing::setTime(time_t UnixTime, uint8_t hundredths){
 }
 
 time_t timing::getTime() {
+  uint8_t hundredths;
+  return getTime(hundredths);
+}
 
+time_t timing::getTime(uint8_t &hundredths) {
+  if (!anchorValid || millis() - anchorMillis >= resyncInterval_ms) resync();
+
+  uint32_t elapsed_ms = (millis() - anchorMillis) + anchorHundredths * 10UL;
+  hundredths = (elapsed_ms % 1000) / 10;
+  return anchorTime + (time_t)(elapsed_ms / 1000);
+}
+
+/*******************************************************************************
+ * Method Name: resync()
+ *******************************************************************************/
+bool timing::resync() {
   time_t time_seconds;
   uint8_t hundredths;
-  ab1805.getRtcAsTime(time_seconds, hundredths);
+  uint32_t readMillis = millis();
 
-  return time_seconds;
+  if (!ab1805.getRtcAsTime(time_seconds, hundredths)) {
+    anchorValid = false;                            // Try again on the next call
+    return false;
+  }
+
+  anchorTime = time_seconds;
+  anchorHundredths = hundredths;
+  anchorMillis = readMillis;
+  anchorValid = true;
+  return true;
 }
 
 
@@ -82,26 +131,266 @@ time_t timing::getTime() {
  * Method Name: update()
  *******************************************************************************/
 bool timing::update(){
- // Need to fill this in once I have the clock working
+  if (!eventCount) return false;
 
-    return true;
+  uint8_t hundredths;
+  time_t now = getTime(hundredths);
+  bool fired = false;
+
+  while (eventCount && (eventQueue[0].time < now || (eventQueue[0].time == now && eventQueue[0].hundredths <= hundredths))) {
+    timedEvent event = eventQueue[0];
+    memmove(&eventQueue[0], &eventQueue[1], (eventCount - 1) * sizeof(timedEvent));
+    eventCount--;
+    firedEvents |= (1 << event.type) & eventFlags_latched;
+    fired = true;
+    Log.infoln("Event %d fired at %l", event.type, now);
+
+    if (event.type == eventFlag_dailyRollover) {     // The day boundary always has a successor - the first one still ahead, so downtime fires it once
+      scheduleEvent(eventFlag_dailyRollover, (now / 86400L + 1) * 86400L);
+    }
+  }
+
+  armNextEvent();
+  return fired;
+}
+
+bool timing::scheduleEvent(uint8_t eventType, time_t UnixTime, uint8_t hundredths) {
+  cancelEvent(eventType);
+  if (eventCount >= eventQueueSize) {
+    Log.infoln("Event queue full - event %d dropped", eventType);
+    return false;
+  }
+
+  uint8_t i = eventCount;                           // Insertion sort - the queue is short
+  while (i > 0 && (eventQueue[i-1].time > UnixTime || (eventQueue[i-1].time == UnixTime && eventQueue[i-1].hundredths > hundredths))) {
+    eventQueue[i] = eventQueue[i-1];
+    i--;
+  }
+  eventQueue[i].time = UnixTime;
+  eventQueue[i].hundredths = hundredths;
+  eventQueue[i].type = eventType;
+  eventCount++;
+
+  armNextEvent();
+  return true;
+}
+
+void timing::cancelEvent(uint8_t eventType) {
+  for (uint8_t i = 0; i < eventCount; i++) {
+    if (eventQueue[i].type == eventType) {
+      memmove(&eventQueue[i], &eventQueue[i+1], (eventCount - i - 1) * sizeof(timedEvent));
+      eventCount--;
+      break;
+    }
+  }
+}
+
+bool timing::eventFired(uint8_t eventType) {
+  uint16_t mask = (1 << eventType);
+  bool fired = (firedEvents & mask) != 0;
+  firedEvents &= ~mask;
+  return fired;
+}
+
+time_t timing::nextEventTime() {
+  return (eventCount) ? eventQueue[0].time : 0;
+}
+
+void timing::armNextEvent() {
+  if (!eventCount) {
+    if (armedTime) ab1805.clearRepeatingInterrupt();
+    armedTime = 0;
+    return;
+  }
+  if (eventQueue[0].time == armedTime && eventQueue[0].hundredths == armedHundredths) return;   // Already programmed
+
+  // The alarm matches minutes, seconds and hundredths, so an event more than an hour out can wake us early.
+  // update() simply finds nothing due and re-arms the same event.
+  ab1805.interruptAtTime(eventQueue[0].time, eventQueue[0].hundredths);
+  armedTime = eventQueue[0].time;
+  armedHundredths = eventQueue[0].hundredths;
+}
+
+/*******************************************************************************
+ * Method Name: syncFromGateway()
+ *******************************************************************************/
+bool timing::syncFromGateway(time_t gatewayTime, uint8_t gatewayHundredths, uint8_t hops, uint8_t retries, uint32_t rxMillis) {
+  uint32_t processing_ms = millis() - rxMillis;     // Time since the packet arrived
+  RxTimeComp_ms = SYNC_AIRTIME_MS + hops * SYNC_HOP_LATENCY_MS + retries * SYNC_RETRY_MS + processing_ms;
+
+  int64_t gateway_ms = (int64_t)gatewayTime * 1000 + gatewayHundredths * 10 + RxTimeComp_ms;
+  Rx_Time_Comp = (uint32_t)(gateway_ms / 1000);
+  Rx_Hundrths_Comp = (uint8_t)((gateway_ms % 1000) / 10);
+
+  uint8_t hundredths;
+  time_t now = getTime(hundredths);
+  int32_t error_ms = (int32_t)(((int64_t)now * 1000 + hundredths * 10) - gateway_ms);
+
+  bool result = true;
+  if (error_ms > (int32_t)RTC_Deadband_ms || error_ms < -(int32_t)RTC_Deadband_ms) {
+    Log.infoln("Clock off by %l msec (compensated %d msec) - setting the RTC", error_ms, RxTimeComp_ms);
+    result = setTime(Rx_Time_Comp, Rx_Hundrths_Comp);
+  }
+  else {
+    Log.infoln("Clock within %d msec of the gateway (%l msec) - not set", RTC_Deadband_ms, error_ms);
+  }
+
+  updateReportSchedule();
+  interruptAtEvent(eventFlag_nxtDvcRpt);            // Wake for our slot in the next window
+  return result;
+}
+
+/*******************************************************************************
+ * Method Name: updateReportSchedule()
+ *******************************************************************************/
+void timing::updateReportSchedule() {
+  uint8_t hundredths;
+  time_t now = getTime(hundredths);
+  int64_t now_ms = (int64_t)now * 1000 + hundredths * 10;
+  int64_t period_ms = (int64_t)nxtRptStrt_sec * 1000;
+
+  int64_t curStart_ms = (now_ms / period_ms) * period_ms;          // Windows are aligned to the period
+  int64_t nxtStart_ms = curStart_ms + period_ms;
+  uint8_t slot = sysStatus.nodeNumber % REPORT_MAX_NODES;
+  int64_t slotOffset_ms = REPORT_GUARD_MS + (int64_t)slot * REPORT_SLOT_MS;
+  int64_t windowLength_ms = REPORT_GUARD_MS + (int64_t)REPORT_MAX_NODES * REPORT_SLOT_MS;
+
+  int64_t curDvcRpt_ms = curStart_ms + slotOffset_ms;
+  int64_t rptEnd_ms = curStart_ms + windowLength_ms;
+  if (rptEnd_ms <= now_ms) rptEnd_ms += period_ms;                 // This window is over - report on the next one's end
+  int64_t nxtDvcRpt_ms = nxtStart_ms + slotOffset_ms;
+
+  curDvcRpt_time = (uint32_t)(curDvcRpt_ms / 1000);
+  curDvcRpt_hund = (uint8_t)((curDvcRpt_ms % 1000) / 10);
+  rptEnd_time = (uint32_t)(rptEnd_ms / 1000);
+  rptEnd_hund = (uint8_t)((rptEnd_ms % 1000) / 10);
+  nxtRptStrt_time = (uint32_t)(nxtStart_ms / 1000);
+  nxtRptStrt_hund = 0;
+  nxtDvcRpt_time = (uint32_t)(nxtDvcRpt_ms / 1000);
+  nxtDvcRpt_hund = (uint8_t)((nxtDvcRpt_ms % 1000) / 10);
+
+  uint32_t nowMillis = millis();                    // The same moments on the millis() clock
+  prevRptStrt_sec = (uint16_t)((now_ms - curStart_ms) / 1000);
+  nxtRptStart_Millis = nowMillis + (uint32_t)(nxtStart_ms - now_ms);
+  dvcRpt_Millis = nowMillis + (uint32_t)(((curDvcRpt_ms > now_ms) ? curDvcRpt_ms : nxtDvcRpt_ms) - now_ms);
+  rptEnd_Millis = nowMillis + (uint32_t)(rptEnd_ms - now_ms);
+
+  Log.infoln("Node %d reports in slot %d - next window %l, our slot at %l.%d", sysStatus.nodeNumber, slot, nxtRptStrt_time, nxtDvcRpt_time, nxtDvcRpt_hund);
+}
+
+/*******************************************************************************
+ * Method Name: recordDrift()
+ *******************************************************************************/
+void timing::recordDrift(time_t UnixTime, uint8_t hundredths) {
+  time_t rtcTime;
+  uint8_t rtcHundredths;
+
+  if (!ab1805.isRTCSet() || !ab1805.getRtcAsTime(rtcTime, rtcHundredths)) {
+    driftRefTime = 0;                               // Nothing to compare against - start over from this sync
+    return;
+  }
+
+  time_t offset_sec = rtcTime - UnixTime;
+  if (offset_sec > DRIFT_MAX_OFFSET_SEC || offset_sec < -DRIFT_MAX_OFFSET_SEC) {
+    Log.infoln("RTC was %l sec off - treated as a reset, drift tracking starts over", (int32_t)offset_sec);
+    driftRefTime = UnixTime;
+    driftOffset_ms = 0;
+    return;
+  }
+
+  int32_t offset_ms = (int32_t)offset_sec * 1000L + ((int32_t)rtcHundredths - hundredths) * 10L;   // Fits - offset_sec is range checked
+  if (!driftRefTime || UnixTime <= driftRefTime) {
+    driftRefTime = UnixTime;
+    driftOffset_ms = 0;
+    return;
+  }
+
+  driftOffset_ms += offset_ms;                      // Each sync corrects the clock, so the drift is the sum of the corrections
+  int32_t elapsed = UnixTime - driftRefTime;
+  if (elapsed < DRIFT_MIN_INTERVAL_SEC) return;     // Too soon to tell drift from jitter - keep accumulating
+
+  int32_t tenths = (int32_t)(((int64_t)driftOffset_ms * 10000L) / elapsed);   // ms per s is 1000 ppm
+  offset_ms = driftOffset_ms;
+  driftRefTime = UnixTime;                          // The next estimate starts here
+  driftOffset_ms = 0;
+  if (tenths > DRIFT_MAX_TENTHS || tenths < -DRIFT_MAX_TENTHS) {
+    Log.infoln("RTC offset of %l ms is not drift - ignored", offset_ms);
+    return;
+  }
+
+  driftTenths[driftNext] = (int16_t)tenths;
+  driftNext = (driftNext + 1) % DRIFT_WINDOW;
+  if (driftCount < DRIFT_WINDOW) driftCount++;
+  Log.infoln("RTC offset %l ms over %l sec - drift estimate %d.%d ppm", offset_ms, elapsed, (int)(tenths / 10), (int)abs(tenths % 10));
+
+  if (driftCount < DRIFT_WINDOW) return;
+
+  int32_t sum = 0;
+  int16_t lowest = driftTenths[0], highest = driftTenths[0];
+  for (uint8_t i = 0; i < DRIFT_WINDOW; i++) {
+    sum += driftTenths[i];
+    if (driftTenths[i] < lowest) lowest = driftTenths[i];
+    if (driftTenths[i] > highest) highest = driftTenths[i];
+  }
+  int32_t average = sum / DRIFT_WINDOW;
+  if (highest - lowest > DRIFT_STABLE_TENTHS || abs(average) < DRIFT_MIN_CORRECTION_TENTHS) return;
+
+  // A fast clock (positive drift) needs a negative adjustment - the register is absolute so add to what is there
+  int32_t newAdjustment = ppmAdjustment - (average + ((average < 0) ? -5 : 5)) / 10;
+  newAdjustment = constrain(newAdjustment, (int32_t)DRIFT_PPM_MIN, (int32_t)DRIFT_PPM_MAX);
+  if (newAdjustment == ppmAdjustment || !ab1805.setPPMAdj((int16_t)newAdjustment)) return;
+
+  Log.infoln("RTC calibration changed from %d to %d ppm", ppmAdjustment, (int)newAdjustment);
+  ppmAdjustment = (int16_t)newAdjustment;
+  rtcMem.put(RTC_KEY_PPM_ADJ, ppmAdjustment);
+  driftCount = 0;                                   // Older estimates describe the old calibration
+  driftNext = 0;
 }
 
 /*******************************************************************************
  * Method Name: InterruptAtEvent()
  *******************************************************************************/
 void timing::interruptAtEvent(uint8_t eventType){
-  
- // Need to fill this in once I have the clock working
-
+  switch (eventType) {
+    case eventFlag_curDvcRpt:
+      scheduleEvent(eventType, curDvcRpt_time, curDvcRpt_hund);
+    break;
+    case eventFlag_rptEnd:
+      scheduleEvent(eventType, rptEnd_time, rptEnd_hund);
+    break;
+    case eventFlag_nxtRptStrt:
+      scheduleEvent(eventType, nxtRptStrt_time, nxtRptStrt_hund);
+    break;
+    case eventFlag_nxtDvcRpt:
+      scheduleEvent(eventType, nxtDvcRpt_time, nxtDvcRpt_hund);
+    break;
+    default:
+      Log.infoln("No time is kept for event %d - use scheduleEvent()", eventType);
+    break;
+  }
 }
 
 void timing::interruptAtTime(time_t UnixTime, uint8_t hundredths){
   ab1805.interruptAtTime(UnixTime,hundredths);
+  armedTime = UnixTime;                             // The queue no longer owns the alarm
+  armedHundredths = hundredths;
 }
 
 void timing::clearRepeatingInterrupt(){
   ab1805.clearRepeatingInterrupt();
+  armedTime = 0;
+}
+
+uint32_t timing::setPeriodicWake(uint32_t period_ms){
+  uint32_t actual_ms;
+  if (!ab1805.setRepeatingCountdownTimer(period_ms, actual_ms)) {
+    Log.infoln("Periodic wake could not be set");
+    periodicWake_ms = 0;
+    return 0;
+  }
+  periodicWake_ms = actual_ms;
+  if (period_ms) Log.infoln("Periodic wake every %l msec", periodicWake_ms);
+  return periodicWake_ms;
 }
 
 void timing::stopWDT(){
@@ -116,6 +405,40 @@ void timing::setWDT(int seconds){
   ab1805.setWDT(seconds);
 }
 
+void timing::registerTask(uint8_t taskID, uint32_t deadline_ms, const char *name) {
+  if (taskID >= wdtTaskCount) return;
+  wdtTasks[taskID].name = name;
+  wdtTasks[taskID].deadline_ms = deadline_ms;
+  wdtTasks[taskID].lastCheckIn = millis();
+  wdtTasks[taskID].registered = true;
+  Log.infoln("Watchdog task %s registered with a %l msec deadline", name, deadline_ms);
+}
+
+void timing::checkIn(uint8_t taskID) {
+  if (taskID < wdtTaskCount) wdtTasks[taskID].lastCheckIn = millis();
+}
+
+/*******************************************************************************
+ * Method Name: serviceWatchdog()
+ *******************************************************************************/
+void timing::serviceWatchdog() {
+  if (millis() - lastWatchdogPet < WDT_PET_INTERVAL_MS) return;
+
+  for (uint8_t i = 0; i < wdtTaskCount; i++) {
+    if (wdtTasks[i].registered && millis() - wdtTasks[i].lastCheckIn > wdtTasks[i].deadline_ms) {
+      if (!stallRecorded) {                         // Leave a note for the next boot - then let the watchdog do its job
+        Log.infoln("Task %s has not checked in for %l msec - watchdog will reset", wdtTasks[i].name, millis() - wdtTasks[i].lastCheckIn);
+        rtcMem.put(RTC_KEY_WDT_TASK, i);
+        stallRecorded = true;
+      }
+      return;
+    }
+  }
+
+  lastWatchdogPet = millis();
+  ab1805.setWDT();
+}
+
 bool timing::isRTCSet(){
   return ab1805.isRTCSet();
 }
@@ -28,6 +28,29 @@
 #define eventFlag_rptEnd 1
 #define eventFlag_nxtRptStrt 2
 #define eventFlag_nxtDvcRpt 3
+#define eventFlag_debounceEnd 4
+#define eventFlag_dailyRollover 5
+#define eventFlags_latched ((1 << eventFlag_debounceEnd) | (1 << eventFlag_dailyRollover))   // Read back with eventFired() - the report events only wake us
+#define eventQueueSize 8
+
+// RTC drift calibration - estimated from the offset seen at each gateway sync
+#define DRIFT_WINDOW 4                                  // Estimates that must agree before the calibration is changed
+#define DRIFT_MIN_INTERVAL_SEC 3600L                    // Shorter sync intervals are dominated by gateway jitter
+#define DRIFT_STABLE_TENTHS 50                          // Window spread (0.1 ppm) that counts as stable
+#define DRIFT_MIN_CORRECTION_TENTHS 20                  // Ignore residual drift smaller than this (0.1 ppm)
+#define DRIFT_MAX_TENTHS 2000                           // Larger "drift" means the clock was set by someone else
+#define DRIFT_MAX_OFFSET_SEC 600L                       // A single correction larger than this is a reset, not a drift sample
+#define DRIFT_PPM_MIN -610                              // Limits of AB1805::setPPMAdj()
+#define DRIFT_PPM_MAX 244
+
+// Task watchdog - each task checks in from its loop and the AB1805 watchdog is only petted when all are current
+#define wdtTask_measure 0
+#define wdtTask_radio 1
+#define wdtTaskCount 2
+#define wdtTaskNone 0xFF
+#define WDT_PET_INTERVAL_MS 30000UL                     // Well inside the 124 second hardware period
+
+extern AB1805 ab1805;                                   // Defined in timing.cpp - shared with rtcStore
 
 
 /**
@@ -65,27 +88,102 @@ public:
     /*
     * @brief Call this to update variables required for timing 
     * 
+    * @details Moves every event in the queue that is now due to the fired list and keeps the earliest
+    * pending event programmed into the AB1805 alarm.  Called from loop().
+    * 
+    * @returns true if at least one event fired
     */
     bool update();
 
+    /**
+     * @brief Add an event to the time-ordered queue - replaces any pending event of the same type
+     *
+     * @details The earliest pending event is always the one programmed into the AB1805 alarm
+     *
+     * @returns false if the queue is full
+     */
+    bool scheduleEvent(uint8_t eventType, time_t UnixTime, uint8_t hundredths = 0);
+
+    /**
+     * @brief Remove a pending event from the queue
+     */
+    void cancelEvent(uint8_t eventType);
+
+    /**
+     * @brief Returns true (once) if an event of this type has fired since the last call - only types in eventFlags_latched
+     */
+    bool eventFired(uint8_t eventType);
+
+    /**
+     * @brief Time of the earliest pending event or 0 if the queue is empty
+     */
+    time_t nextEventTime();
+
     /**
      * @brief set the time based on the value we recieved from the LoRa Gateway
+     *
+     * @details The RTC offset found just before the write is used to estimate the crystal drift (see recordDrift())
      */
     bool setTime(time_t UnixTime, uint8_t hundredths);
 
+    /**
+     * @brief Full sync path for a time message from the gateway
+     *
+     * @details Compensates the gateway time for air time, repeater hops, retransmissions and the time since the
+     * packet arrived (RxTimeComp_ms, Rx_Time_Comp, Rx_Hundrths_Comp).  The RTC is only written when our clock
+     * is off by more than RTC_Deadband_ms.  Then the next reporting window and this node's slot in it are
+     * derived from sysStatus.nodeNumber and the wake for the slot is queued.
+     *
+     * @param gatewayTime - UNIX time in the message
+     * @param gatewayHundredths - hundredths in the message
+     * @param hops - repeaters between the gateway and this node
+     * @param retries - retransmissions before the message got through
+     * @param rxMillis - millis() when the packet was received
+     *
+     * @returns true if the clock was within the deadband or was set successfully
+     */
+    bool syncFromGateway(time_t gatewayTime, uint8_t gatewayHundredths, uint8_t hops, uint8_t retries, uint32_t rxMillis);
+
+    /**
+     * @brief Works out the current and next reporting windows and this node's slot from the current time
+     */
+    void updateReportSchedule();
+
+    /**
+     * @brief The XT calibration currently applied with AB1805::setPPMAdj() - positive speeds the clock up
+     */
+    int16_t getPPMAdjustment() { return ppmAdjustment; }
+
     /**
      * @brief - Get the time in UNITX Time format - GMT
+     *
+     * @details Served from an anchor pair (RTC time, millis()) in constant time - the RTC is only read when
+     * the anchor is missing or older than resyncInterval_ms
     */
    time_t getTime();
 
+    /**
+     * @brief - Get the time in UNIX Time format - GMT - along with the hundredths of a second
+    */
+   time_t getTime(uint8_t &hundredths);
+
+    /**
+     * @brief Re-read the RTC and anchor the software clock to it
+     *
+     * @details Call this after waking from sleep - millis() does not advance while the MCU is asleep
+     */
+    bool resync();
+
     /**
      * @brief set an interrupt for a future time based on an event type
      * 
      * @details This is used to set a specific interrupt type at an event in the future
-     * This is will first calculate the duration of time to the event of interest and then set an interrupt on the AB1805
+     * The event time is taken from the matching *_time / *_hund fields and added to the event queue
      * 
      * @param eventType 
      * Available Event Types are:
+     *      eventFlag_curDvcRpt - Set an interrupt when this device's current report slot starts
+     *      eventFlag_rptEnd - Set an interrupt when the reporting window ends
      *      eventFlag_nxtRptStrt - Set an interrupt when the next reporting window starts
      *      eventFlag_nxtDvcRpt - Set an interrupt when this device should report it's data
      */
@@ -103,6 +201,24 @@ public:
     */
     void interruptAtTime(time_t UnixTime, uint8_t hundredths);
 
+    /**
+     * @brief Wake the MCU every period_ms using the AB1805's repeating countdown timer
+     *
+     * @details The timer reloads itself, so nothing needs to be reprogrammed each cycle. It shares the WAKE pin
+     * with the event alarm, so LowPower.sleep() needs no timeout of its own.
+     *
+     * @param period_ms - 0 stops the periodic wake. Resolution is 1/64 sec up to ~4 sec, 1 sec up to 255 sec,
+     * then 1 minute up to 255 minutes.
+     *
+     * @returns the period actually programmed in msec (0 if stopped or on error)
+     */
+    uint32_t setPeriodicWake(uint32_t period_ms);
+
+    /**
+     * @brief The period programmed by setPeriodicWake() in msec (0 if not running)
+     */
+    uint32_t getPeriodicWake() { return periodicWake_ms; }
+
     /**
      * @brief set the time based on the value we recieved from the LoRa Gateway
      */
@@ -118,6 +234,25 @@ public:
      */
     void setWDT(int seconds = -1);
 
+    /**
+     * @brief Add a task to the task watchdog
+     *
+     * @param taskID - wdtTask_measure or wdtTask_radio
+     * @param deadline_ms - longest the task may go between check-ins (awake time - millis() stops while asleep)
+     * @param name - used in the log when the task stalls
+     */
+    void registerTask(uint8_t taskID, uint32_t deadline_ms, const char *name);
+
+    /**
+     * @brief Called by a registered task each time through its loop to show it is still making progress
+     */
+    void checkIn(uint8_t taskID);
+
+    /**
+     * @brief The task that stopped the watchdog from being petted before the last reset (wdtTaskNone if none)
+     */
+    uint8_t getStalledTask() { return stalledTask; }
+
     /**
      * @brief returns true if the RTC is set, otherwise returns false
      */
@@ -149,11 +284,67 @@ public:
     time_t      time_cv;
     uint8_t     hundrths_cv;
     uint32_t    WDT_MaxSleepDuration = 113000;  // This is the maximum sleep duration before the watchdog must be pet. 
+    uint32_t    resyncInterval_ms = 600000;     // How long getTime() extrapolates from millis() before re-reading the RTC
 
 
 protected:
     const uint16_t  RTC_Deadband_ms = 20; // The deadband correction 
 
+    time_t          anchorTime = 0;         // RTC seconds at the anchor
+    uint8_t         anchorHundredths = 0;   // RTC hundredths at the anchor
+    uint32_t        anchorMillis = 0;       // millis() at the anchor
+    bool            anchorValid = false;    // False until the RTC has been read (or set) - forces a resync
+
+    /**
+     * @brief Programs the AB1805 alarm for the earliest pending event (or clears it if there is none)
+     */
+    void armNextEvent();
+
+    /**
+     * @brief Turn the RTC offset at a gateway sync into a drift estimate and recalibrate once the estimates agree
+     *
+     * @details The RTC was exact at the previous sync, so offset / elapsed time is the residual drift of the
+     * current calibration.  Estimates are kept in a sliding window and the correction is applied only when the
+     * whole window lies within DRIFT_STABLE_TENTHS.  The window restarts after every calibration change.
+     */
+    void recordDrift(time_t UnixTime, uint8_t hundredths);
+
+    /**
+     * @brief Pets the AB1805 watchdog every WDT_PET_INTERVAL_MS - but only while every registered task is current
+     */
+    void serviceWatchdog();
+
+    struct wdtTask {
+        const char  *name;
+        uint32_t    deadline_ms;
+        uint32_t    lastCheckIn;
+        bool        registered;
+    };
+    wdtTask         wdtTasks[wdtTaskCount];
+    uint32_t        lastWatchdogPet = 0;
+    uint8_t         stalledTask = wdtTaskNone;          // Task that caused the last watchdog reset (from RTC RAM)
+    bool            stallRecorded = false;              // The current stall has already been written to RTC RAM
+
+    uint32_t        periodicWake_ms = 0;                // Repeating countdown timer period (0 = off)
+
+    int16_t         ppmAdjustment = 0;                  // Calibration currently in the AB1805 (ppm)
+    time_t          driftRefTime = 0;                   // Sync that started the current estimate (0 = none yet)
+    int32_t         driftOffset_ms = 0;                 // Corrections applied since driftRefTime - positive = RTC was fast
+    int16_t         driftTenths[DRIFT_WINDOW];          // Recent residual drift estimates in 0.1 ppm - positive = RTC fast
+    uint8_t         driftCount = 0;                     // Estimates in the window (saturates at DRIFT_WINDOW)
+    uint8_t         driftNext = 0;                      // Next slot to overwrite
+
+    struct timedEvent {
+        time_t      time;
+        uint8_t     hundredths;
+        uint8_t     type;
+    };
+    timedEvent      eventQueue[eventQueueSize];     // Pending events, earliest first
+    uint8_t         eventCount = 0;
+    uint16_t        firedEvents = 0;                // One bit per event type that has fired and not been consumed
+    time_t          armedTime = 0;                  // Event currently programmed into the AB1805 alarm (0 = none)
+    uint8_t         armedHundredths = 0;
+
     /**
      * @brief The constructor is protected because the class is a singleton
      * 
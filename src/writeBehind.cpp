@@ -0,0 +1,53 @@
+#include "writeBehind.h"
+#include "Config.h"
+
+writeBehind *writeBehind::_instance;
+
+static const char *flushReasons[] = {"sleep", "stale", "low battery", "power down"};
+
+// [static]
+writeBehind &writeBehind::instance() {
+    if (!_instance) {
+        _instance = new writeBehind();
+    }
+    return *_instance;
+}
+
+writeBehind::writeBehind() {
+}
+
+writeBehind::~writeBehind() {
+}
+
+void writeBehind::loop() {
+    if (!isDirty()) return;
+
+    time_t now = timeFunctions.getTime();
+    if (!dirtySince) dirtySince = now;                              // Start the clock on the oldest change
+    else if (now - dirtySince >= (time_t)PERSIST_MAX_STALE_SEC) flush(flushReason_stale);
+}
+
+bool writeBehind::flush(uint8_t reason) {
+    bool wrote = false;
+    long age = (dirtySince) ? (long)(timeFunctions.getTime() - dirtySince) : 0L;
+
+    if (sysData.sysDataChanged) {
+        if (sysData.storeSysData()) sysData.sysDataChanged = false; // Left set on a failed write so the next flush tries again
+        wrote = true;
+    }
+    if (currentData.currentDataChanged) {
+        currentData.storeCurrentData();                             // Clears the flag - sets it again if the write failed
+        wrote = true;
+    }
+    if (wrote) Log.infoln("Persistent data flushed (%s) after %l seconds", flushReasons[reason], age);
+
+    // The last write cycle is still running - a stale flush lets the loop carry on and the next access polls for it
+    if (reason == flushReason_sleep) eepromOverlapSleep();         // The EEPROM finishes on its own while we sleep
+    else if (reason != flushReason_stale) eepromWaitReady();       // Power may be going - make sure the cycle is done
+    dirtySince = 0;
+    return wrote;
+}
+
+bool writeBehind::isDirty() const {
+    return sysData.sysDataChanged || currentData.currentDataChanged;
+}
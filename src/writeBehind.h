@@ -0,0 +1,106 @@
+/**
+ * @file    writeBehind.h
+ * @author  Chip McClelland (chip@seeinsights.com)
+ * @brief   Coalesces changes to the persistent data and writes them to EEPROM once, instead of as they happen
+ * @details The EEPROM costs ~5 msec of awake time per page and wears with every write, so the currentDataChanged
+ * and sysDataChanged flags are no longer acted on straight away.  Everything that is dirty is written in one
+ * flush - just before the node sleeps, when the oldest change has waited PERSIST_MAX_STALE_SEC, or when the
+ * battery goes low.  RTC time is used for the deadline because millis() stands still while we sleep.
+ *
+ * @version 0.1
+ * @date    2024-10-20
+ *
+ */
+
+#ifndef __WRITEBEHIND_H
+#define __WRITEBEHIND_H
+
+#include <arduino.h>
+#include <ArduinoLog.h>
+#include "MyData.h"
+#include "timing.h"
+
+#define persistence writeBehind::instance()
+
+// Why a flush happened - for the log
+#define flushReason_sleep 0
+#define flushReason_stale 1
+#define flushReason_lowBattery 2
+#define flushReason_powerDown 3
+
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * From global application loop you must call:
+ * writeBehind::instance().loop();
+ *
+ * Call flush() before LowPower.sleep() and onLowBattery() when the battery state drops.
+ */
+class writeBehind {
+public:
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use writeBehind::instance() to instantiate the singleton.
+     */
+    static writeBehind &instance();
+
+    /**
+     * @brief Notices new changes and flushes once the oldest has passed the staleness deadline
+     */
+    void loop();
+
+    /**
+     * @brief Writes everything that is dirty
+     *
+     * @param reason - one of the flushReason_ values
+     *
+     * @returns true if anything was written
+     */
+    bool flush(uint8_t reason);
+
+    /**
+     * @brief Flush now - the next brown-out could take unsaved counts with it
+     */
+    bool onLowBattery() { return flush(flushReason_lowBattery); }
+
+    /**
+     * @brief True if either structure has changes that are not in EEPROM yet
+     */
+    bool isDirty() const;
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use writeBehind::instance() to instantiate the singleton.
+     */
+    writeBehind();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~writeBehind();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    writeBehind(const writeBehind&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    writeBehind& operator=(const writeBehind&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static writeBehind *_instance;
+
+    time_t dirtySince = 0;                              // RTC time the oldest unsaved change was first seen (0 = clean)
+};
+
+#endif  /* __WRITEBEHIND_H */
@@ -0,0 +1,123 @@
+// Host-side checks for the AB1805 register <-> Unix time conversions (pio test -e native)
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <unity.h>
+#include "AB1805_Time.h"
+
+static const time_t FIRST_DAY = 946684800;          // 2000-01-01 00:00:00 UTC
+static const time_t LAST_DAY = 4102358400;          // 2099-12-31 00:00:00 UTC
+
+// Seconds into the day to check on every date - midnight, the last second and a few in between
+static const int32_t sampleSeconds[] = {0, 1, 59, 60, 3599, 3600, 43199, 43200, 45296, 86340, 86399};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void expectRegistersMatch(time_t t, const uint8_t *regs) {
+  struct tm ref;
+  gmtime_r(&t, &ref);
+  char msg[48];
+  snprintf(msg, sizeof(msg), "t=%lld", (long long)t);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(ref.tm_sec, AB1805Time::bcdToValue(regs[0]), msg);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(ref.tm_min, AB1805Time::bcdToValue(regs[1]), msg);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(ref.tm_hour, AB1805Time::bcdToValue(regs[2]), msg);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(ref.tm_mday, AB1805Time::bcdToValue(regs[3]), msg);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(ref.tm_mon + 1, AB1805Time::bcdToValue(regs[4]), msg);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(ref.tm_year % 100, AB1805Time::bcdToValue(regs[5]), msg);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(ref.tm_wday, AB1805Time::bcdToValue(regs[6]), msg);
+}
+
+// Unix time -> registers agrees with gmtime, and registers -> Unix time gets back the same second
+void test_unix_round_trip_every_day(void) {
+  uint8_t regs[7];
+  for (time_t day = FIRST_DAY; day <= LAST_DAY; day += 86400) {
+    for (size_t i = 0; i < sizeof(sampleSeconds) / sizeof(sampleSeconds[0]); i++) {
+      time_t t = day + sampleSeconds[i];
+      AB1805Time::unixToRegisters(t, regs, true);
+      expectRegistersMatch(t, regs);
+      TEST_ASSERT_EQUAL_INT64((long long)t, (long long)AB1805Time::registersToUnix(regs));
+    }
+  }
+}
+
+// Registers built from a struct tm convert to the same second as timegm
+void test_registers_match_timegm(void) {
+  uint8_t regs[7];
+  for (time_t day = FIRST_DAY; day <= LAST_DAY; day += 86400) {
+    struct tm tm;
+    time_t t = day + 45296;                         // 12:34:56
+    gmtime_r(&t, &tm);
+    regs[0] = AB1805Time::valueToBcd(tm.tm_sec);
+    regs[1] = AB1805Time::valueToBcd(tm.tm_min);
+    regs[2] = AB1805Time::valueToBcd(tm.tm_hour);
+    regs[3] = AB1805Time::valueToBcd(tm.tm_mday);
+    regs[4] = AB1805Time::valueToBcd(tm.tm_mon + 1);
+    regs[5] = AB1805Time::valueToBcd(tm.tm_year % 100);
+    regs[6] = AB1805Time::valueToBcd(tm.tm_wday);
+    TEST_ASSERT_EQUAL_INT64((long long)timegm(&tm), (long long)AB1805Time::registersToUnix(regs));
+  }
+}
+
+// The GP bits that share the seconds, minutes, hours, date and month registers are ignored
+void test_registers_ignore_gp_bits(void) {
+  uint8_t regs[7];
+  time_t t = 1722075454;                            // 2024-07-27 10:17:34
+  AB1805Time::unixToRegisters(t, regs, true);
+  regs[0] |= 0x80;
+  regs[1] |= 0x80;
+  regs[2] |= 0xc0;
+  regs[3] |= 0xc0;
+  regs[4] |= 0xe0;
+  TEST_ASSERT_EQUAL_INT64((long long)t, (long long)AB1805Time::registersToUnix(regs));
+}
+
+// Alarm layout has no year register - the weekday follows the month
+void test_alarm_registers_without_year(void) {
+  uint8_t withYear[7], alarm[6];
+  time_t t = 951782400;                             // 2000-02-29 00:00:00
+  AB1805Time::unixToRegisters(t, withYear, true);
+  AB1805Time::unixToRegisters(t, alarm, false);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(withYear, alarm, 5);
+  TEST_ASSERT_EQUAL_HEX8(withYear[6], alarm[5]);
+}
+
+// Time per conversion against the libc struct tm path the integer math replaced
+void test_benchmark(void) {
+  const int rounds = 200000;
+  uint8_t regs[7];
+  volatile long long sink = 0;
+  char msg[96];
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    time_t t = FIRST_DAY + (time_t)i * 15733;       // Spread across the century
+    AB1805Time::unixToRegisters(t, regs, true);
+    sink += AB1805Time::registersToUnix(regs);
+  }
+  double integerNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    time_t t = FIRST_DAY + (time_t)i * 15733;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    sink += timegm(&tm);
+  }
+  double libcNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+  snprintf(msg, sizeof(msg), "round trip: integer %.1f ns, gmtime/timegm %.1f ns", integerNs, libcNs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(sink != 0);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_unix_round_trip_every_day);
+  RUN_TEST(test_registers_match_timegm);
+  RUN_TEST(test_registers_ignore_gp_bits);
+  RUN_TEST(test_alarm_registers_without_year);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
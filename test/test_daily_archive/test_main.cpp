@@ -0,0 +1,162 @@
+// Host-side checks for the daily archive ring and the order it is written in (pio test -e native)
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "archiveRing.h"
+
+static const uint16_t FIRST_DAY = 20000;            // 2024-10-04
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static ArchiveRing::daySummary makeDay(uint16_t day) {
+  ArchiveRing::daySummary summary;
+  summary.day = day;
+  summary.occupiedSec = (day % 1000) * 60UL;
+  summary.sessions = day % 200;
+  summary.peakHour = day % 24;
+  return summary;
+}
+
+static void emptyArchive(uint8_t *img) {
+  memset(img, 0xA5, ARCHIVE_IMAGE_SIZE);            // Whatever the EEPROM held before
+  ArchiveRing::reset(img, 0);
+  ArchiveRing::seal(img);
+}
+
+// Adds a day the way dailyArchive::closeDay() does, without tearing
+static void addDay(uint8_t *img, uint16_t day) {
+  uint8_t staged[ARCHIVE_IMAGE_SIZE], final[ARCHIVE_IMAGE_SIZE];
+  ArchiveRing::addDay(img, makeDay(day), staged, final);
+  ArchiveRing::seal(final);
+  memcpy(img, final, ARCHIVE_IMAGE_SIZE);
+}
+
+static void expectSameDays(const uint8_t *expected, const uint8_t *actual, const char *msg) {
+  TEST_ASSERT_TRUE_MESSAGE(ArchiveRing::valid(actual), msg);
+  TEST_ASSERT_EQUAL_UINT8_MESSAGE(ArchiveRing::count(expected), ArchiveRing::count(actual), msg);
+  TEST_ASSERT_EQUAL_UINT16_MESSAGE(ArchiveRing::oldestDay(expected), ArchiveRing::oldestDay(actual), msg);
+  for (uint8_t i = 0; i < ArchiveRing::count(expected); i++) {
+    ArchiveRing::daySummary want, got;
+    ArchiveRing::readDay(expected, i, want);
+    ArchiveRing::readDay(actual, i, got);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(want.occupiedSec, got.occupiedSec, msg);
+    TEST_ASSERT_EQUAL_UINT16_MESSAGE(want.sessions, got.sessions, msg);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(want.peakHour, got.peakHour, msg);
+  }
+}
+
+// Writes the bytes of next that differ from device one at a time, checking what a reboot would find after each.
+// Every byte before the header is torn off is checked against committed, and the header commits next.
+static void tearWhileWriting(uint8_t *device, const uint8_t *committed, const uint8_t *next, const char *name) {
+  char msg[64];
+  for (size_t i = ARCHIVE_HEADER_SIZE; i < ARCHIVE_IMAGE_SIZE; i++) {       // Data first, as dailyArchive::write()
+    if (device[i] == next[i]) continue;
+    device[i] = next[i];
+    snprintf(msg, sizeof(msg), "%s: torn after data byte %u", name, (unsigned)i);
+    expectSameDays(committed, device, msg);
+  }
+  snprintf(msg, sizeof(msg), "%s: header never written", name);
+  expectSameDays(committed, device, msg);
+
+  memcpy(device, next, ARCHIVE_HEADER_SIZE);
+  snprintf(msg, sizeof(msg), "%s: header written", name);
+  expectSameDays(next, device, msg);
+}
+
+// Adds a day the way dailyArchive::closeDay() does, tearing the write at every byte on the way
+static void addDayTearing(uint8_t *img, uint16_t day, const char *name) {
+  uint8_t staged[ARCHIVE_IMAGE_SIZE], final[ARCHIVE_IMAGE_SIZE], device[ARCHIVE_IMAGE_SIZE];
+  memcpy(device, img, sizeof(device));
+  if (ArchiveRing::addDay(img, makeDay(day), staged, final)) {
+    ArchiveRing::seal(staged);
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(&img[ARCHIVE_HEADER_SIZE], &staged[ARCHIVE_HEADER_SIZE], ARCHIVE_DATA_SIZE, "staged must only change the header");
+    tearWhileWriting(device, img, staged, name);
+    memcpy(img, staged, ARCHIVE_IMAGE_SIZE);
+  }
+  ArchiveRing::seal(final);
+  tearWhileWriting(device, img, final, name);
+  memcpy(img, final, ARCHIVE_IMAGE_SIZE);
+}
+
+// Consecutive days fill the ring and then roll the oldest off
+void test_days_roll_over(void) {
+  uint8_t img[ARCHIVE_IMAGE_SIZE];
+  emptyArchive(img);
+  for (uint16_t day = FIRST_DAY; day < FIRST_DAY + 100; day++) addDay(img, day);
+
+  TEST_ASSERT_TRUE(ArchiveRing::valid(img));
+  TEST_ASSERT_EQUAL_UINT8(ARCHIVE_MAX_DAYS, ArchiveRing::count(img));
+  TEST_ASSERT_EQUAL_UINT16(FIRST_DAY + 100 - ARCHIVE_MAX_DAYS, ArchiveRing::oldestDay(img));
+  for (uint8_t i = 0; i < ARCHIVE_MAX_DAYS; i++) {
+    ArchiveRing::daySummary got, want = makeDay(ArchiveRing::oldestDay(img) + i);
+    ArchiveRing::readDay(img, i, got);
+    TEST_ASSERT_EQUAL_UINT16(want.day, got.day);
+    TEST_ASSERT_EQUAL_UINT32(want.occupiedSec, got.occupiedSec);
+    TEST_ASSERT_EQUAL_UINT16(want.sessions, got.sessions);
+    TEST_ASSERT_EQUAL_UINT8(want.peakHour, got.peakHour);
+  }
+}
+
+// Missed days are held as gaps, and a gap longer than the archive starts it over
+void test_gaps(void) {
+  uint8_t img[ARCHIVE_IMAGE_SIZE];
+  ArchiveRing::daySummary got;
+  emptyArchive(img);
+  addDay(img, FIRST_DAY);
+  addDay(img, FIRST_DAY + 3);
+  TEST_ASSERT_EQUAL_UINT8(4, ArchiveRing::count(img));
+  ArchiveRing::readDay(img, 1, got);
+  TEST_ASSERT_EQUAL_UINT8(ARCHIVE_GAP, got.peakHour);
+  ArchiveRing::readDay(img, 2, got);
+  TEST_ASSERT_EQUAL_UINT8(ARCHIVE_GAP, got.peakHour);
+  ArchiveRing::readDay(img, 3, got);
+  TEST_ASSERT_EQUAL_UINT16(FIRST_DAY + 3, got.day);
+
+  addDay(img, FIRST_DAY + 3 + ARCHIVE_MAX_DAYS);                // The archive is all gaps but the new day
+  TEST_ASSERT_TRUE(ArchiveRing::valid(img));
+  TEST_ASSERT_EQUAL_UINT8(ARCHIVE_MAX_DAYS, ArchiveRing::count(img));
+  TEST_ASSERT_EQUAL_UINT16(FIRST_DAY + 4, ArchiveRing::oldestDay(img));
+
+  addDay(img, FIRST_DAY + 4 + 2 * ARCHIVE_MAX_DAYS);            // Nothing held is recent enough to keep
+  TEST_ASSERT_TRUE(ArchiveRing::valid(img));
+  TEST_ASSERT_EQUAL_UINT8(1, ArchiveRing::count(img));
+  TEST_ASSERT_EQUAL_UINT16(FIRST_DAY + 4 + 2 * ARCHIVE_MAX_DAYS, ArchiveRing::oldestDay(img));
+}
+
+// A write torn anywhere before the header leaves every day that was committed
+void test_torn_writes_keep_committed_days(void) {
+  uint8_t img[ARCHIVE_IMAGE_SIZE];
+  emptyArchive(img);
+  uint16_t day = FIRST_DAY;
+  addDayTearing(img, day, "first day");
+  for (int i = 0; i < 40; i++) addDayTearing(img, ++day, "next day");      // Fills the ring and wraps it
+  day += 4;
+  addDayTearing(img, day, "full with gaps");
+  day += 20;
+  addDayTearing(img, day, "full with a long gap");
+  day += ARCHIVE_MAX_DAYS + 5;
+  addDayTearing(img, day, "start over");
+  TEST_ASSERT_EQUAL_UINT8(1, ArchiveRing::count(img));
+}
+
+// The CRC only covers the days held - changing a free slot does not touch it, changing a held one does
+void test_crc_covers_held_days_only(void) {
+  uint8_t img[ARCHIVE_IMAGE_SIZE];
+  emptyArchive(img);
+  for (uint16_t day = FIRST_DAY; day < FIRST_DAY + 5; day++) addDay(img, day);
+
+  img[ArchiveRing::recordOffset(img, 5)] ^= 0xFF;
+  TEST_ASSERT_TRUE(ArchiveRing::valid(img));
+  img[ArchiveRing::recordOffset(img, 4) + 1] ^= 0x01;
+  TEST_ASSERT_FALSE(ArchiveRing::valid(img));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_days_roll_over);
+  RUN_TEST(test_gaps);
+  RUN_TEST(test_torn_writes_keep_committed_days);
+  RUN_TEST(test_crc_covers_held_days_only);
+  return UNITY_END();
+}
@@ -0,0 +1,103 @@
+// Host-side checks for the presence fusion rules (pio test -e native)
+#include <unity.h>
+#include "PresenceFusion.h"
+
+static const time_t NOW = 1722075454;               // 2024-07-27 10:17:34
+static const uint16_t WINDOW = 60;
+
+static PresenceFusion &fusion = PresenceFusion::instance();
+
+void setUp(void) {
+  fusion.setup();
+  fusion.setDetector(DETECTOR_ACCEL, true);
+  fusion.setDetector(DETECTOR_PIR, true);
+}
+
+void tearDown(void) {}
+
+// A detector that is not enabled is ignored
+void test_disabled_detector_ignored(void) {
+  fusion.setDetector(DETECTOR_PIR, false);
+  fusion.setRule(FUSION_RULE_ANY_OF, WINDOW);
+  TEST_ASSERT_FALSE(fusion.reportEvent(DETECTOR_PIR, NOW));
+  TEST_ASSERT_FALSE(fusion.evaluate(NOW));
+  TEST_ASSERT_EQUAL_UINT8(0, fusion.getConfidence());
+}
+
+// Any one detector inside the window is enough, and the evidence runs out with the window
+void test_any_of(void) {
+  fusion.setRule(FUSION_RULE_ANY_OF, WINDOW);
+  TEST_ASSERT_TRUE(fusion.reportEvent(DETECTOR_PIR, NOW));
+  TEST_ASSERT_TRUE(fusion.evaluate(NOW));
+  TEST_ASSERT_EQUAL_UINT8(100, fusion.getConfidence());
+  TEST_ASSERT_TRUE(fusion.evaluate(NOW + WINDOW / 2));
+  TEST_ASSERT_EQUAL_UINT8(50, fusion.getConfidence());
+  TEST_ASSERT_FALSE(fusion.evaluate(NOW + WINDOW));
+}
+
+// k of n needs k detectors inside the same window - fewer only raises the confidence
+void test_k_of_n(void) {
+  fusion.setRule(FUSION_RULE_K_OF_N, WINDOW, 2);
+  fusion.reportEvent(DETECTOR_ACCEL, NOW);
+  TEST_ASSERT_FALSE(fusion.evaluate(NOW));
+  TEST_ASSERT_EQUAL_UINT8(50, fusion.getConfidence());
+  TEST_ASSERT_TRUE(fusion.confirmationNeeded());
+
+  fusion.reportEvent(DETECTOR_PIR, NOW + 10);
+  TEST_ASSERT_TRUE(fusion.evaluate(NOW + 10));
+  TEST_ASSERT_EQUAL_UINT8(100, fusion.getConfidence());
+
+  TEST_ASSERT_FALSE(fusion.evaluate(NOW + WINDOW));                 // The accelerometer event has aged out
+  TEST_ASSERT_EQUAL_UINT8(50, fusion.getConfidence());
+}
+
+// k is capped at the number of enabled detectors
+void test_k_of_n_more_than_enabled(void) {
+  fusion.setRule(FUSION_RULE_K_OF_N, WINDOW, 3);
+  fusion.reportEvent(DETECTOR_ACCEL, NOW);
+  TEST_ASSERT_FALSE(fusion.evaluate(NOW));
+  fusion.reportEvent(DETECTOR_PIR, NOW);
+  TEST_ASSERT_TRUE(fusion.evaluate(NOW));
+}
+
+// The weighted rule takes the weighted mean of each detector's decaying evidence against the threshold
+void test_weighted(void) {
+  fusion.setRule(FUSION_RULE_WEIGHTED, WINDOW);
+  fusion.setDetector(DETECTOR_ACCEL, true, 100);
+  fusion.setDetector(DETECTOR_PIR, true, 50);
+  fusion.setThreshold(60);
+
+  fusion.reportEvent(DETECTOR_PIR, NOW);
+  TEST_ASSERT_FALSE(fusion.evaluate(NOW));                          // 50 * 100 / 150
+  TEST_ASSERT_EQUAL_UINT8(33, fusion.getConfidence());
+
+  fusion.reportEvent(DETECTOR_ACCEL, NOW);
+  TEST_ASSERT_TRUE(fusion.evaluate(NOW));
+  TEST_ASSERT_EQUAL_UINT8(100, fusion.getConfidence());
+
+  TEST_ASSERT_FALSE(fusion.evaluate(NOW + WINDOW / 2));             // Both at half strength
+  TEST_ASSERT_EQUAL_UINT8(50, fusion.getConfidence());
+}
+
+// A strong detector alone can carry the weighted rule
+void test_weighted_single_strong_detector(void) {
+  fusion.setRule(FUSION_RULE_WEIGHTED, WINDOW);
+  fusion.setDetector(DETECTOR_ACCEL, true, 100);
+  fusion.setDetector(DETECTOR_PIR, true, 50);
+  fusion.setThreshold(60);
+
+  fusion.reportEvent(DETECTOR_ACCEL, NOW);
+  TEST_ASSERT_TRUE(fusion.evaluate(NOW));                           // 100 * 100 / 150
+  TEST_ASSERT_EQUAL_UINT8(66, fusion.getConfidence());
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_disabled_detector_ignored);
+  RUN_TEST(test_any_of);
+  RUN_TEST(test_k_of_n);
+  RUN_TEST(test_k_of_n_more_than_enabled);
+  RUN_TEST(test_weighted);
+  RUN_TEST(test_weighted_single_strong_detector);
+  return UNITY_END();
+}